@@ -27,6 +27,7 @@
 #include <network/InetSocketPeer.h>
 #include <network/PeerException.h>
 #include <network/Buffer.h>
+#include <network/Frame.h>
 
 #ifdef FEATURE_LOCAL_SESSIONS
 #include <client/local/LocalSession.h>
@@ -381,7 +382,7 @@ struct RegistrationData {
     unsigned short mMessagingAPIVersionMajor;
     unsigned short mMessagingAPIVersionMinor;
     unsigned short mMessagingAPIVersionPatch;
-    unsigned short mReserved; // for alignment
+    unsigned short mFrameVersion; // highest frame header version we can receive (was reserved)
 
     // changes above this point may break protocol version checking
 
@@ -396,7 +397,7 @@ struct RegistrationData {
                      mMessagingAPIVersionMajor(major),
                      mMessagingAPIVersionMinor(minor),
                      mMessagingAPIVersionPatch(patch),
-                     mReserved(0) {};
+                     mFrameVersion(0) {};
 };
 
 void
@@ -415,6 +416,7 @@ Client::connectTCP()
                              ARRAS_MESSAGING_API_VERSION_MINOR,
                              ARRAS_MESSAGING_API_VERSION_PATCH);
     regData.mSessionId = api::UUID(mSessionId.c_str());
+    regData.mFrameVersion = Frame::VERSION_CURRENT;
     inetSocketPeer->send_or_throw(&regData, sizeof(regData),"Client::connectTCP");
 
     // steal the object out of the unique ptr since it will now
@@ -56,7 +56,9 @@ inline Object withSource(ObjectConstRef sourceId) {
     return ret;
 }
 inline Object withSource(const Message& msg) {
-    return withSource(msg.get(MessageData::sourceId));
+    Object ret;
+    ret[MessageOptions::sourceId] = msg.sourceId().toString();
+    return ret;
 }
 inline Object withSource(const std::string& sourceId) {
     Object ret;
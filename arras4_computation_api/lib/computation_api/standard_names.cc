@@ -13,8 +13,12 @@ const std::string ConfigNames::maxThreads        = "limits.maxThreads";
 const std::string ConfigNames::maxMemoryMB       = "limits.maxMemoryMB"; 
 
 const std::string PropNames::wantsHyperthreading = "arras.wantsHyperthreading";
+const std::string PropNames::handlerThreads      = "arras.handlerThreads";
+const std::string PropNames::handlerOrdering     = "arras.handlerOrdering";
+const std::string PropNames::wantsIdle           = "arras.wantsIdle";
 
 const std::string EnvNames::apiVersion           = "arras.apiVersion";
 const std::string EnvNames::computationName      = "computation.name";
+const std::string EnvNames::idleNoWork           = "arras.idleNoWork";
 }
 }
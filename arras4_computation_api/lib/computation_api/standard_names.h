@@ -24,6 +24,15 @@ struct ConfigNames {
 struct PropNames {
     // define as 'true' to enable hyperthreading (i.e. maxThreads > maxCores)
      static const std::string wantsHyperthreading;
+    // define as an integer > 1 to have onMessage() called concurrently on
+    // that many threads. Messages with the same ordering key are still
+    // handled one at a time, in order. Queried after configure("initialize")
+    static const std::string handlerThreads;
+    // key for handlerThreads : "sender" (default), "sourceId" or "routingName"
+    static const std::string handlerOrdering;
+    // define as 'false' if the computation doesn't implement onIdle(),
+    // so that it is never called
+    static const std::string wantsIdle;
 };
 
 // standard environment variables that computations may query by calling
@@ -33,6 +42,10 @@ struct EnvNames {
     // e.g."4.0.0"
     static const std::string apiVersion; // queryable, not settable
     static const std::string computationName; // queryable, not settable
+    // set to 'true' during onIdle() to report that there was nothing
+    // to do. While this continues, onIdle() is called less and less
+    // often, until a message arrives
+    static const std::string idleNoWork; // settable, not queryable
 };
 
 
@@ -23,6 +23,11 @@ public:
     void toObject(api::ObjectRef obj);
     void fromObject(api::ObjectConstRef obj);
     std::string describe() const { return mRoutingName; }
+    api::UUID getInstanceId() const { return mInstanceId; }
+    api::UUID getSourceId() const { return mSourceId; }
+    api::ArrasTime getCreationTime() const { return mCreationTime; }
+    api::Address getFrom() const { return mFrom; }
+    std::string getRoutingName() const { return mRoutingName; }
 
     // implementation functions
     const api::UUID& instanceId() const { return mInstanceId; }
@@ -14,12 +14,17 @@
 #include <shared_impl/RegistrationData.h>
 #include <shared_impl/ProcessExitCodes.h>
 
+#include <network/Frame.h>
 #include <network/IPCSocketPeer.h>
+#ifdef PLATFORM_LINUX
+#include <network/SharedMemoryPeer.h>
+#endif
 
 #include <arras4_log/Logger.h>
 #include <arras4_log/LogEventStream.h>
 #include <arras4_athena/AthenaLogger.h>
 
+#include <algorithm>
 #include <fstream>
 
 #if defined(JSONCPP_VERSION_MAJOR)
@@ -28,6 +33,7 @@
 
 using namespace arras4::log;
 using namespace arras4::api;
+using arras4::network::Frame;
 
 namespace arras4 {
     namespace impl {
@@ -150,6 +156,17 @@ int ExecComp::run()
             ofs.close();
          }
 
+        // frame header version supported by node. If node can receive
+        // large frames, big messages don't need to be chunked
+        unsigned frameVersion = Frame::VERSION_BASIC;
+        if (mConfig["frameVersion"].isIntegral()) {
+            frameVersion = std::min(mConfig["frameVersion"].asUInt(), Frame::VERSION_CURRENT);
+        }
+        if (frameVersion >= Frame::VERSION_LARGE &&
+            !computationConfig.isMember("chunking")) {
+            computationConfig["chunking"] = false;
+        }
+
         // 2) Create and initialize the environment
         CompEnvironmentImpl env(computationName,dsoName,computationAddress);
 	if (!env.setRouting(routing)) {
@@ -168,9 +185,26 @@ int ExecComp::run()
 
         ARRAS_DEBUG("Connecting to node");
         std::unique_ptr<arras4::network::IPCSocketPeer> peer = connectToServer(computationAddress,ipcAddr);
+        arras4::network::Peer* dataPeer = peer.get();
+
+        // if requested, node will follow registration by offering a shared memory 
+        // segment over the IPC socket, which then carries all message data.
+        // 'peer' must stay open : shmPeer watches it to find out if node
+        // goes away without closing the shared memory rings
+#ifdef PLATFORM_LINUX
+        std::unique_ptr<arras4::network::SharedMemoryPeer> shmPeer;
+        if (mConfig["ipcSharedMemory"].isBool() && mConfig["ipcSharedMemory"].asBool()) {
+            ARRAS_DEBUG("Attaching to node shared memory");
+            shmPeer.reset(new arras4::network::SharedMemoryPeer);
+            shmPeer->accept(*peer);
+            dataPeer = shmPeer.get();
+        }
+#endif
+
         std::string traceInfo("C:"+ computationAddress.computation.toString() +
                               " N:"+computationAddress.node.toString());
-        PeerMessageEndpoint endpoint(*peer,true,traceInfo);
+        PeerMessageEndpoint endpoint(*dataPeer,true,traceInfo);
+        endpoint.setFrameVersion(frameVersion);
 
 
         // 4) turn on autosave of messages if requested
@@ -240,6 +274,7 @@ ExecComp::connectToServer(const Address& compAddr,
     regData.mComputationId = compAddr.computation;
     regData.mNodeId = compAddr.node;
     regData.mSessionId = compAddr.session;
+    regData.mFrameVersion = Frame::VERSION_CURRENT;
 
     std::unique_ptr<arras4::network::IPCSocketPeer> ipcSocketPeer(new arras4::network::IPCSocketPeer);
     ipcSocketPeer->connect(ipcAddr);
@@ -0,0 +1,91 @@
+// Copyright 2023-2024 DreamWorks Animation LLC and Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "ChunkSink.h"
+
+#include <exceptions/InternalError.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace arras4 {
+    namespace impl {
+
+ChunkSink::ChunkSink(size_t chunkSize, size_t totalSize,
+                     const ChunkFunction& onChunk)
+    : mChunkSize(chunkSize),
+      mTotalSize(totalSize),
+      mOnChunk(onChunk)
+{
+}
+
+ChunkSink::~ChunkSink()
+{
+    delete[] mChunk;
+}
+
+// allocate the next chunk : the last one is only as big as it needs to be
+void ChunkSink::startChunk()
+{
+    size_t remaining = mTotalSize - mBytesWritten;
+    if (remaining == 0)
+        throw InternalError("[ChunkSink] More data was serialized than was measured");
+    mChunkLength = std::min(mChunkSize, remaining);
+    mChunk = new unsigned char[mChunkLength];
+    mChunkUsed = 0;
+}
+
+// hand on the current chunk
+void ChunkSink::endChunk()
+{
+    unsigned char* chunk = mChunk;
+    size_t length = mChunkUsed;
+    mChunk = nullptr;
+    mChunkLength = mChunkUsed = 0;
+    mOnChunk(chunk, length);
+}
+
+size_t ChunkSink::write(const unsigned char* aBuf, size_t aLen)
+{
+    size_t done = 0;
+    while (done < aLen) {
+        if (!mChunk)
+            startChunk();
+        size_t n = std::min(aLen - done, mChunkLength - mChunkUsed);
+        std::memcpy(mChunk + mChunkUsed, aBuf + done, n);
+        mChunkUsed += n;
+        mBytesWritten += n;
+        done += n;
+        if (mChunkUsed == mChunkLength)
+            endChunk();
+    }
+    return done;
+}
+
+void ChunkSink::flush()
+{
+    if (mBytesWritten != mTotalSize)
+        throw InternalError("[ChunkSink] Less data was serialized than was measured");
+}
+
+unsigned char* ChunkSink::writeWindow(size_t& aAvailable)
+{
+    if (!mChunk)
+        startChunk();
+    aAvailable = mChunkLength - mChunkUsed;
+    return mChunk + mChunkUsed;
+}
+
+void ChunkSink::commitWrite(size_t aLength)
+{
+    if (!mChunk)
+        return;
+    aLength = std::min(aLength, mChunkLength - mChunkUsed);
+    mChunkUsed += aLength;
+    mBytesWritten += aLength;
+    if (mChunkUsed == mChunkLength)
+        endChunk();
+}
+
+}
+}
@@ -0,0 +1,62 @@
+// Copyright 2023-2024 DreamWorks Animation LLC and Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __ARRAS4_CHUNK_SINKH__
+#define __ARRAS4_CHUNK_SINKH__
+
+#include <network/DataSink.h>
+
+#include <functional>
+
+namespace arras4 {
+    namespace impl {
+
+// DataSink that splits the data written to it into chunks of a fixed
+// size, handing each chunk on as soon as it is full. This lets
+// ChunkingMessageEndpoint send the chunks of a large message while it
+// is still being serialized, so at most one chunk is held by the sink.
+//
+// The total size must be known exactly in advance (from 
+// CountingOutStream::exactSize(), not the serializedLength() hint), so
+// that the last chunk is allocated at its exact size. Writing more
+// than this, or flushing before it has all been written, throws
+// InternalError.
+class ChunkSink : public network::DataSink
+{
+public:
+    // called with each chunk in turn. Ownership of 'data', which was
+    // allocated with new[], passes to the callback
+    using ChunkFunction = std::function<void(unsigned char* data, size_t length)>;
+
+    ChunkSink(size_t chunkSize, size_t totalSize,
+              const ChunkFunction& onChunk);
+    ~ChunkSink();
+
+    ChunkSink(const ChunkSink&) = delete;
+    ChunkSink& operator=(const ChunkSink&) = delete;
+
+    size_t write(const unsigned char* aBuf, size_t aLen);
+    // checks that all the data has been written
+    void flush();
+    size_t bytesWritten() const { return mBytesWritten; }
+
+    unsigned char* writeWindow(size_t& aAvailable);
+    void commitWrite(size_t aLength);
+
+private:
+    void startChunk();
+    void endChunk();
+
+    size_t mChunkSize;
+    size_t mTotalSize;
+    ChunkFunction mOnChunk;
+
+    unsigned char* mChunk = nullptr;
+    size_t mChunkLength = 0; // allocated size of mChunk
+    size_t mChunkUsed = 0;
+    size_t mBytesWritten = 0;
+};
+
+}
+}
+#endif
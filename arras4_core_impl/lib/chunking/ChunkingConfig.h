@@ -5,6 +5,7 @@
 #define __ARRAS4_CHUNKING_CONFIGH__
 
 #include <stddef.h>
+#include <chrono>
 
 namespace arras4 {
     namespace impl {
@@ -14,9 +15,28 @@ class ChunkingConfig
 public:
     bool enabled = true;
     // default settings are to avoid messages > 2GB in size, since
-    // these are not supported by Arras 3
+    // these are not supported by Arras 3. Chunking is unnecessary
+    // if both ends of the connection support large frames (see 
+    // network/Frame.h)
     size_t minChunkingSize =  2047 * 1024  * 1024ull; // 2GB - 1MB
     size_t chunkSize =  1024 * 1024  * 1024ull; // 1GB
+
+    // content is only chunked if its serializedLength() hint is at least
+    // minChunkingSize. Most content returns 0, and so is never chunked
+    // unless chunkUnsized is set, in which case an extra counting pass
+    // is made over such content to find its size
+    bool chunkUnsized = false;
+
+    // limits on reassembly of received chunked messages. A message
+    // larger than maxMessageBytes is discarded. If the chunks held for
+    // all incomplete messages would exceed maxReassemblyBytes, the
+    // messages that have waited longest for a chunk are discarded to
+    // make room. A message is also discarded if no chunk of it arrives
+    // for reassemblyTimeout (checked as messages are received). Zero
+    // means no limit
+    size_t maxMessageBytes = 0;
+    size_t maxReassemblyBytes = 0;
+    std::chrono::seconds reassemblyTimeout = std::chrono::seconds(600);
 };
 
 }
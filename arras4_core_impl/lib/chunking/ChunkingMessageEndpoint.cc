@@ -2,21 +2,24 @@
 // SPDX-License-Identifier: Apache-2.0
 
 #include "ChunkingMessageEndpoint.h"
+#include "ChunkSink.h"
 #include "MessageChunk.h"
 #include "MessageUnchunker.h"
 
 #include <message_api/ObjectContent.h>
+#include <message_impl/CountingOutStream.h>
 #include <message_impl/StreamImpl.h>
-#include <network/network_types.h>
-#include <network/Buffer.h>
-#include <network/MultiBuffer.h>
 #include <arras4_log/Logger.h>
 #include <arras4_log/LogEventStream.h>
 #include <exceptions/InternalError.h>
 #include <message_impl/Envelope.h>
+#include <message_impl/MessageReader.h>
+#include <message_impl/OpaqueContent.h>
+
+#include <algorithm>
+#include <vector>
 
 using namespace arras4::api;
-using namespace arras4::network;
 
 namespace arras4 {
     namespace impl {
@@ -29,12 +32,44 @@ Envelope ChunkingMessageEndpoint::getEnvelope()
     // or a chunk that completes a message
     while (true) {
         Envelope envelope = mSource.getEnvelope();
+        Clock::time_point now = Clock::now();
+        expireUnchunkers(now);
         if (envelope.classId() != MessageChunk::ID) {
             return envelope;
         }
 
+        // a reader that doesn't use the content registry delivers
+        // chunks as OpaqueContent
+        MessageReader::deserializeContent(envelope);
         MessageChunk::ConstPtr chunk = envelope.contentAs<MessageChunk>();
-        UnchunkerMap::iterator it = mUnchunkers.find(chunk->internalInstanceId);
+        if (!chunk)
+            throw InternalError("[ChunkingMessageEndpoint/getEnvelope] Couldn't read message chunk");
+        api::UUID instanceId = chunk->internalInstanceId;
+
+        // ignore the rest of a message that has been discarded
+        std::map<api::UUID,Clock::time_point>::iterator dit = mDiscarded.find(instanceId);
+        if (dit != mDiscarded.end()) {
+            dit->second = now;
+            continue;
+        }
+
+        UnchunkerMap::iterator it = mUnchunkers.find(instanceId);
+        uint64_t held = (it == mUnchunkers.end()) ? 0 : it->second->bytes();
+        if (mConfig.maxMessageBytes &&
+            (chunk->mUnchunkedSize > mConfig.maxMessageBytes ||
+             held + chunk->mPayloadLength > mConfig.maxMessageBytes)) {
+            mRejectedCount++;
+            discard(instanceId, "it is larger than the limit of " +
+                    std::to_string(mConfig.maxMessageBytes) + " bytes", now);
+            continue;
+        }
+        if (!makeRoom(instanceId, chunk->mPayloadLength)) {
+            mRejectedCount++;
+            discard(instanceId, "it is larger than the reassembly limit of " +
+                    std::to_string(mConfig.maxReassemblyBytes) + " bytes", now);
+            continue;
+        }
+
         MessageUnchunker* unchunker;
         if (it == mUnchunkers.end()) {
             unchunker = new MessageUnchunker(chunk);
@@ -45,45 +80,205 @@ Envelope ChunkingMessageEndpoint::getEnvelope()
             unchunker = it->second.get();
             unchunker->addChunk(chunk);
         }
-        if (unchunker->getUnchunked(envelope))
-        {
+        bool complete = unchunker->getUnchunked(envelope);
+        if (complete)
             mUnchunkers.erase(it);
+        updateInFlight();
+        if (complete)
             return envelope;
-        } 
     }
 }
 
+// discard incomplete messages that haven't received a chunk within
+// the reassembly timeout. Runs at most once a second
+void ChunkingMessageEndpoint::expireUnchunkers(const Clock::time_point& now)
+{
+    if (now - mLastExpiryCheck < std::chrono::seconds(1))
+        return;
+    mLastExpiryCheck = now;
+
+    std::chrono::seconds timeout = mConfig.reassemblyTimeout;
+    if (timeout.count() > 0) {
+        std::vector<api::UUID> expired;
+        for (const UnchunkerMap::value_type& entry : mUnchunkers) {
+            if (now - entry.second->lastActivity() > timeout)
+                expired.push_back(entry.first);
+        }
+        for (const api::UUID& instanceId : expired) {
+            mExpiredCount++;
+            discard(instanceId, "no chunk has arrived for " +
+                    std::to_string(timeout.count()) + " seconds", now);
+        }
+    } else {
+        timeout = ChunkingConfig().reassemblyTimeout;
+    }
+
+    // forget discarded messages once their chunks have stopped arriving
+    for (std::map<api::UUID,Clock::time_point>::iterator it = mDiscarded.begin();
+         it != mDiscarded.end(); ) {
+        if (now - it->second > timeout)
+            it = mDiscarded.erase(it);
+        else
+            ++it;
+    }
+}
+
+// make room for 'bytes' more bytes of message 'instanceId' within
+// maxReassemblyBytes, by discarding the incomplete messages that have
+// waited longest. Returns false if the message can't fit even then
+bool ChunkingMessageEndpoint::makeRoom(const api::UUID& instanceId, uint64_t bytes)
+{
+    if (mConfig.maxReassemblyBytes == 0)
+        return true;
+    uint64_t total = mInFlightBytes;
+    while (total + bytes > mConfig.maxReassemblyBytes) {
+        UnchunkerMap::iterator oldest = mUnchunkers.end();
+        for (UnchunkerMap::iterator it = mUnchunkers.begin(); it != mUnchunkers.end(); ++it) {
+            if (it->first != instanceId &&
+                (oldest == mUnchunkers.end() ||
+                 it->second->lastActivity() < oldest->second->lastActivity()))
+                oldest = it;
+        }
+        if (oldest == mUnchunkers.end())
+            return false;
+        total -= oldest->second->bytes();
+        mEvictedCount++;
+        discard(oldest->first, "memory is needed for newer chunked messages", Clock::now());
+    }
+    return true;
+}
+
+// takes a copy of the id, since it may refer to the entry being erased
+void ChunkingMessageEndpoint::discard(api::UUID instanceId,
+                                      const std::string& reason,
+                                      const Clock::time_point& now)
+{
+    ARRAS_WARN(log::Id("chunkedMessageDiscarded") <<
+               "Discarding chunked message " << instanceId.toString() <<
+               " because " << reason);
+    mUnchunkers.erase(instanceId);
+    mDiscarded[instanceId] = now;
+    updateInFlight();
+}
+
+void ChunkingMessageEndpoint::updateInFlight()
+{
+    uint64_t bytes = 0;
+    for (const UnchunkerMap::value_type& entry : mUnchunkers)
+        bytes += entry.second->bytes();
+    mInFlightBytes = bytes;
+    mInFlightMessages = mUnchunkers.size();
+    if (bytes > mPeakInFlightBytes)
+        mPeakInFlightBytes = bytes;
+}
+
+ChunkingMessageEndpoint::ReassemblyStats ChunkingMessageEndpoint::reassemblyStats() const
+{
+    ReassemblyStats stats;
+    stats.inFlightBytes = mInFlightBytes;
+    stats.peakInFlightBytes = mPeakInFlightBytes;
+    stats.inFlightMessages = mInFlightMessages;
+    stats.expiredMessages = mExpiredCount;
+    stats.evictedMessages = mEvictedCount;
+    stats.rejectedMessages = mRejectedCount;
+    return stats;
+}
+
 void ChunkingMessageEndpoint::putEnvelope(const Envelope& envelope)
 {
     if (!mConfig.enabled) {
         mSource.putEnvelope(envelope);
         return;
     }
+
+    OpaqueContent::ConstPtr opaque = envelope.contentAs<OpaqueContent>();
+    if (opaque && opaque->dataBuffer()) {
+        putOpaque(envelope, opaque->dataBuffer());
+        return;
+    }
         
     std::shared_ptr<const ObjectContent> content = envelope.contentAs<ObjectContent>();  
     if (content == nullptr) {
-        // can't chunk messages that aren't ObjectContent
+        // can't chunk messages that aren't ObjectContent or OpaqueContent
         mSource.putEnvelope(envelope);
         return;
     }
 
-    // Check if the serialized form of the content is long enough to need chunking
+    // Check if the serialized form of the content is long enough to need chunking.
     // serializedLength is optional : many subclasses will return 0,
-    // making them unchunkable
-    size_t unchunkedSize = content->serializedLength();
+    // making them unchunkable unless chunkUnsized is set. Only content 
+    // that may be chunked is measured
+    size_t sizeHint = content->serializedLength();
+    if (sizeHint == 0 && !mConfig.chunkUnsized) {
+        mSource.putEnvelope(envelope);
+        return;
+    }
+    if (sizeHint != 0 && sizeHint < mConfig.minChunkingSize) {
+        mSource.putEnvelope(envelope);
+        return;
+    }
+
+    // serializedLength() is only a hint, but the chunk headers need the
+    // exact size, so count it
+    size_t unchunkedSize = CountingOutStream::exactSize(*content);
     if (unchunkedSize < mConfig.minChunkingSize) {
         mSource.putEnvelope(envelope);
         return;
     }
 
-    // serialize the content into a MultiBuffer that will
-    // split it into chunks
-    MultiBuffer mb(mConfig.chunkSize,mConfig.chunkSize);
-    OutStreamImpl stream(mb);
-    content->serialize(stream);
-    stream.flush();
+    // the number of chunks is known up front, so each chunk can be sent
+    // as soon as serialization has filled it, rather than serializing the
+    // whole message first. Only the chunk being filled is held in memory
+    uint16_t numChunks = chunkCount(envelope, unchunkedSize);
+    uint16_t index = 0;
+    auto onChunk = [&](unsigned char* data, size_t length) {
+        MessageChunk::Ptr chunk = std::make_shared<MessageChunk>();
+        chunk->mPayloadLength = static_cast<unsigned>(length);
+        chunk->mPayload = data; // chunk takes ownership
+        sendChunk(envelope, chunk, numChunks, index++, unchunkedSize);
+    };
+
+    ChunkSink sink(mConfig.chunkSize, unchunkedSize, onChunk);
+    OutStreamImpl stream(sink);
+    try {
+        content->serialize(stream);
+        stream.flush();
+    } catch (...) {
+        // don't let the stream send a partial chunk on destruction
+        stream.discard();
+        throw;
+    }
+}
 
-    size_t numChunks64 = mb.bufferCount();
+// Opaque content (e.g. a message being passed on without being
+// deserialized) is already serialized, so each chunk is simply a slice
+// of its buffer : the data isn't copied
+void ChunkingMessageEndpoint::putOpaque(const Envelope& envelope,
+                                        const network::BufferConstPtr& data)
+{
+    size_t unchunkedSize = data->remaining();
+    if (unchunkedSize < mConfig.minChunkingSize) {
+        mSource.putEnvelope(envelope);
+        return;
+    }
+
+    uint16_t numChunks = chunkCount(envelope, unchunkedSize);
+    for (uint16_t index = 0; index < numChunks; index++) {
+        size_t offset = index * mConfig.chunkSize;
+        MessageChunk::Ptr chunk = std::make_shared<MessageChunk>();
+        chunk->mPayloadLength = static_cast<unsigned>(std::min(mConfig.chunkSize,
+                                                               unchunkedSize - offset));
+        // the chunk only reads the payload of a slice
+        chunk->mPayload = const_cast<unsigned char*>(data->start()) + offset;
+        chunk->mPayloadSource = data;
+        sendChunk(envelope, chunk, numChunks, index, unchunkedSize);
+    }
+}
+
+uint16_t ChunkingMessageEndpoint::chunkCount(const Envelope& envelope,
+                                             size_t unchunkedSize)
+{
+    size_t numChunks64 = (unchunkedSize + mConfig.chunkSize - 1) / mConfig.chunkSize;
     if (numChunks64 > UINT16_MAX)
         throw InternalError("[ChunkingMessageEndpoint/putEnvelope] Message is too large for chunking");
     uint16_t numChunks = static_cast<uint16_t>(numChunks64);
@@ -91,34 +286,36 @@ void ChunkingMessageEndpoint::putEnvelope(const Envelope& envelope)
     ARRAS_INFO("Message " << envelope.metadata()->instanceId().toString() <<
                " length " << unchunkedSize << " will be broken into " <<
                numChunks << " chunks of size <= " << mConfig.chunkSize);
+    return numChunks;
+}
 
-    for (uint16_t index = 0; index < numChunks; index++)
-    {
-        MessageChunk::Ptr chunk = std::make_shared<MessageChunk>();
-        Envelope chunkEnv(chunk);
-        chunkEnv.metadata() = envelope.metadata();
-        chunkEnv.to() = envelope.to();
-
-        chunk->mChunkingMethod = 0;
-        chunk->mNumberOfChunks = numChunks;
-        chunk->mChunkIndex = index;
-        chunk->mOffset = index*mConfig.chunkSize;
-        chunk->mUnchunkedSize = unchunkedSize;
-        chunk->internalId = envelope.classId();
-        chunk->internalRoutingName = envelope.metadata()->routingName();
-        chunk->internalInstanceId = envelope.metadata()->instanceId();
-        chunk->internalOriginId = envelope.metadata()->sourceId();
-        chunk->internalClassVersion = envelope.classVersion();
-
-        // grab the buffer from the multibuffer and move it to the message
-        BufferUniquePtr buf(mb.takeBuffer(index));
-        chunk->mPayloadLength = static_cast<unsigned>(buf->bytesWritten());
-        chunk->mPayload = buf->initial();
-        buf->releaseData(); // prevents buffer cleaning it up
-
-        // send message chunk to source
-        mSource.putEnvelope(chunkEnv);
-    }
+// fill in the header of a chunk of 'envelope' and send it
+void ChunkingMessageEndpoint::sendChunk(const Envelope& envelope,
+                                        const MessageChunk::Ptr& chunk,
+                                        uint16_t numChunks, uint16_t index,
+                                        size_t unchunkedSize)
+{
+    Envelope chunkEnv(chunk);
+    chunkEnv.metadata() = envelope.metadata();
+    chunkEnv.setTo(envelope.toList());
+
+    chunk->mChunkingMethod = 0;
+    chunk->mNumberOfChunks = numChunks;
+    chunk->mChunkIndex = index;
+    chunk->mOffset = index*mConfig.chunkSize;
+    chunk->mUnchunkedSize = unchunkedSize;
+    chunk->internalId = envelope.classId();
+    chunk->internalRoutingName = envelope.metadata()->routingName();
+    chunk->internalInstanceId = envelope.metadata()->instanceId();
+    chunk->internalOriginId = envelope.metadata()->sourceId();
+    chunk->internalClassVersion = envelope.classVersion();
+
+    // send message chunk to source
+    mSource.putEnvelope(chunkEnv);
+
+    // give urgent messages a chance to go out between chunks
+    if (mFrameGapCallback && index + 1 < numChunks)
+        mFrameGapCallback();
 }
 
 }
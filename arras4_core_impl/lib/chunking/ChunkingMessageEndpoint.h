@@ -7,18 +7,39 @@
 #include "ChunkingConfig.h"
 #include <message_api/UUID.h>
 #include <message_impl/MessageEndpoint.h>
+#include <network/network_types.h>
+#include <atomic>
+#include <chrono>
+#include <map>
 #include <memory>
+#include <string>
 
 // This is a message endpoint filter that handles message chunking
 namespace arras4 {
     namespace impl {
 
+class MessageChunk;
 class MessageUnchunker;
 class Envelope;
 
+// Received chunks are held until their message is complete, subject to
+// the reassembly limits in ChunkingConfig. Messages that break the limits
+// are discarded with a warning, together with any of their chunks that
+// arrive later.
 class ChunkingMessageEndpoint : public MessageEndpoint
 {
 public:
+    // statistics on reassembly of chunked messages. May be read
+    // from any thread
+    struct ReassemblyStats {
+        uint64_t inFlightBytes = 0;     // held for incomplete messages
+        uint64_t peakInFlightBytes = 0; // high water mark of inFlightBytes
+        uint64_t inFlightMessages = 0;  // incomplete messages
+        uint64_t expiredMessages = 0;   // discarded by reassemblyTimeout
+        uint64_t evictedMessages = 0;   // discarded by maxReassemblyBytes
+        uint64_t rejectedMessages = 0;  // too big for the limits on arrival
+    };
+
     ChunkingMessageEndpoint(MessageEndpoint& source,
                             const ChunkingConfig& config = ChunkingConfig()) :
         mConfig(config),
@@ -28,12 +49,45 @@ public:
     Envelope getEnvelope();
     void putEnvelope(const Envelope& env);
     void shutdown() { mSource.shutdown(); }
+    void setFrameGapCallback(const FrameGapCallback& callback)
+        { mFrameGapCallback = callback; }
+    void beginBatch() { mSource.beginBatch(); }
+    void endBatch() { mSource.endBatch(); }
+
+    ReassemblyStats reassemblyStats() const;
 
 private:
+    void putOpaque(const Envelope& envelope, const network::BufferConstPtr& data);
+    uint16_t chunkCount(const Envelope& envelope, size_t unchunkedSize);
+    void sendChunk(const Envelope& envelope,
+                   const std::shared_ptr<MessageChunk>& chunk,
+                   uint16_t numChunks, uint16_t index,
+                   size_t unchunkedSize);
+
+    using Clock = std::chrono::steady_clock;
+    void expireUnchunkers(const Clock::time_point& now);
+    bool makeRoom(const api::UUID& instanceId, uint64_t bytes);
+    void discard(api::UUID instanceId, const std::string& reason,
+                 const Clock::time_point& now);
+    void updateInFlight();
+
     ChunkingConfig mConfig;
+    FrameGapCallback mFrameGapCallback;
     MessageEndpoint& mSource;
     typedef std::map<api::UUID,std::shared_ptr<MessageUnchunker>> UnchunkerMap;
     UnchunkerMap mUnchunkers;
+
+    // messages that have been discarded, so that their remaining
+    // chunks are ignored. Forgotten after reassemblyTimeout
+    std::map<api::UUID,Clock::time_point> mDiscarded;
+    Clock::time_point mLastExpiryCheck;
+
+    std::atomic<uint64_t> mInFlightBytes{0};
+    std::atomic<uint64_t> mPeakInFlightBytes{0};
+    std::atomic<uint64_t> mInFlightMessages{0};
+    std::atomic<uint64_t> mExpiredCount{0};
+    std::atomic<uint64_t> mEvictedCount{0};
+    std::atomic<uint64_t> mRejectedCount{0};
 };
 
 }
@@ -12,7 +12,8 @@ ARRAS_CONTENT_IMPL(MessageChunk);
 
 MessageChunk::~MessageChunk()
 {
-    delete[] mPayload;
+    if (!mPayloadSource)
+        delete[] mPayload;
 }
 
 void
@@ -6,6 +6,7 @@
 
 #include <message_api/ContentMacros.h>
 #include <message_api/UUID.h>
+#include <network/network_types.h>
 #include <string>
 
 namespace arras4 {
@@ -36,7 +37,11 @@ public:
 
     // payload of this chunk
     unsigned int mPayloadLength=0;
-    unsigned char* mPayload=0; // array
+    unsigned char* mPayload=0; // array, owned by the chunk unless mPayloadSource is set
+
+    // when a chunk is a slice of an existing buffer, mPayload points into
+    // this buffer, and the chunk holds on to it rather than to a copy
+    network::BufferConstPtr mPayloadSource;
 
 };
 
@@ -11,6 +11,7 @@
 #include <network/Buffer.h>
 #include <network/MultiBuffer.h>
 #include <message_impl/Envelope.h>
+#include <message_impl/OpaqueContent.h>
 #include <message_impl/StreamImpl.h>
 
 #include <string.h> // memcpy
@@ -36,6 +37,7 @@ namespace impl {
             throw InternalError("[MessageChunker] Chunk count is less than 1");
         }
         mInstanceId = chunk->internalInstanceId;
+        mUnchunkedSize = chunk->mUnchunkedSize;
         mChunks.resize(mNumChunks);
         mCount = 0;
         addChunk(chunk);
@@ -52,12 +54,18 @@ namespace impl {
             ARRAS_ERROR(log::Id("invalidMessageChunk") << "Message chunk contained incorrect data");
             throw InternalError("[MessageChunker/addChunk] Chunk data mismatch");
         }
+        if (chunk->mChunkIndex >= mNumChunks) {
+            ARRAS_ERROR(log::Id("invalidMessageChunk") << "Message chunk index is out of range");
+            throw InternalError("[MessageChunker/addChunk] Chunk index out of range");
+        }
         if (mChunks[chunk->mChunkIndex]) {
             ARRAS_ERROR(log::Id("invalidMessageChunk") << "Message chunk duplicates one already received");
             throw InternalError("[MessageChunker/addChunk] Duplicate chunk received");
         }
         mChunks[chunk->mChunkIndex] = chunk;
         mCount++;
+        mBytes += chunk->mPayloadLength;
+        mLastActivity = std::chrono::steady_clock::now();
     }
 
     // if message is complete, update envout and return true
@@ -100,12 +108,16 @@ namespace impl {
         ObjectContent* objContent = ContentRegistry::singleton()->
             create(classId,version);
         if (!objContent) {
-            ARRAS_ERROR(log::Id("chunkingClassError") << 
-                        "Couldn't recreate chunked message : message class " <<
-                        classId.toString() << " could not be instantiated");
-                        
-            throw InternalError("[MessageUnchunker/getUnchunked] Failed to instantiate message class :" +
-                                classId.toString());
+            // the class isn't known here, so the message can only be
+            // passed on : deliver it as OpaqueContent, in the same way
+            // as MessageReader does for unknown classes
+            ARRAS_DEBUG("Chunked message class " << classId.toString() <<
+                        " isn't registered : delivering it as opaque content");
+            BufferPtr data = std::make_shared<Buffer>(sumLen);
+            for (unsigned i = 0; i < mNumChunks; i++)
+                data->write(mChunks[i]->mPayload, mChunks[i]->mPayloadLength);
+            envOut.setContent(new OpaqueContent(classId,version,data));
+            return true;
         }
     
         // create a multibuffer to deserialize from
@@ -7,6 +7,7 @@
 #include <message_api/messageapi_types.h>
 #include <message_api/UUID.h>
 
+#include <chrono>
 #include <vector>
 #include <memory>
 
@@ -26,16 +27,29 @@ public:
     // call to add subsequent chunks (not the first)
     void addChunk(const std::shared_ptr<const MessageChunk>& chunk);
 
-    // if message is complete, update envout and return true
+    // if message is complete, update envout and return true. If the
+    // message class isn't registered, the content is OpaqueContent
     bool getUnchunked(Envelope& envOut);
 
     typedef std::shared_ptr<MessageUnchunker> Ptr;
+
+    // payload bytes held in the chunks received so far
+    uint64_t bytes() const { return mBytes; }
+    // size of the message once complete, as given by its chunks
+    uint64_t unchunkedSize() const { return mUnchunkedSize; }
+    // when the last chunk was added
+    const std::chrono::steady_clock::time_point& lastActivity() const
+        { return mLastActivity; }
+    const api::UUID& instanceId() const { return mInstanceId; }
  
 private:
 
     unsigned mNumChunks;
     api::UUID mInstanceId;
     unsigned mCount;
+    uint64_t mBytes = 0;
+    uint64_t mUnchunkedSize = 0;
+    std::chrono::steady_clock::time_point mLastActivity;
 
     std::vector<std::shared_ptr<const MessageChunk>> mChunks;
 };
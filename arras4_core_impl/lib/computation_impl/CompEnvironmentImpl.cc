@@ -101,27 +101,33 @@ api::Object CompEnvironmentImpl::environment(const std::string& name)
     return api::Object();
 }
 
-api::Result CompEnvironmentImpl::setEnvironment(const std::string& /*name*/, 
-                                                api::ObjectConstRef /*value*/)
+api::Result CompEnvironmentImpl::setEnvironment(const std::string& name, 
+                                                api::ObjectConstRef value)
 {
+    if (name == api::EnvNames::idleNoWork) {
+        if (!value.isBool())
+            return api::Result::Invalid;
+        mIdleNoWork = value.asBool();
+        return api::Result::Success;
+    }
     return api::Result::Unknown;
 }
  
 void CompEnvironmentImpl::handleMessage(const api::Message& message)
 {
-    api::Object instId = message.get(api::MessageData::instanceId);
-    api::Object routingName = message.get(api::MessageData::routingName);
+    // the typed accessors are used here, rather than get(), so that
+    // nothing is built for the trace unless it is enabled
     ARRAS_ATHENA_TRACE(2,"{trace:message} dispatch " <<
-                       (instId.isString() ? instId.asString() : "<error>") << " " <<
+                       message.instanceId().toString() << " " <<
                        mAddress.computation.toString() << " " <<
-                       (routingName.isString() ? routingName.asString() : "<error>"));
+                       message.routingName());
 
     api::Result result = mComputation->onMessage(message);
 
     ARRAS_ATHENA_TRACE(2,"{trace:message} handled " <<
-                       (instId.isString() ? instId.asString() : "<error>") << " " <<
+                       message.instanceId().toString() << " " <<
                        mAddress.computation.toString() << " " <<
-                       (routingName.isString() ? routingName.asString() : "<error>") << " " <<
+                       message.routingName() << " " <<
                        static_cast<int>(result));
 
     if (result == api::Result::Unknown) {
@@ -132,9 +138,13 @@ void CompEnvironmentImpl::handleMessage(const api::Message& message)
     }
 }
 
-void CompEnvironmentImpl::onIdle()
+// returns false if the computation reported that it
+// had nothing to do, so that the dispatcher backs off
+bool CompEnvironmentImpl::onIdle()
 {
+    mIdleNoWork = false;
     mComputation->onIdle();
+    return !mIdleNoWork;
 }
 
 // startup procedure:
@@ -155,6 +165,7 @@ CompEnvironmentImpl::initializeComputation(ExecutionLimits& limits,
                                            api::ObjectRef config)
 {
     applyChunkingConfig(config);
+    applyQueueConfig(config);
     // check if computation wants hyperthreading
     api::Object wantsHyperthreading = 
         mComputation->property(api::PropNames::wantsHyperthreading);
@@ -172,6 +183,9 @@ CompEnvironmentImpl::initializeComputation(ExecutionLimits& limits,
     if (res == api::Result::Invalid) {
         ARRAS_ERROR(log::Id("compConfigFailed") << 
                     "Configuration of the computation failed. Not starting execution.");
+    } else {
+        applyHandlerPoolProperties(limits);
+        applyIdleProperties(config);
     }
 
     return res;
@@ -197,6 +211,131 @@ CompEnvironmentImpl::applyChunkingConfig(api::ObjectRef config)
         chunkSize += config["chunkSizeBytes"].asInt();
     if (chunkSize)
         mChunkingConfig.chunkSize = chunkSize;
+    if (config["chunkUnsizedContent"].isBool())
+        mChunkingConfig.chunkUnsized = config["chunkUnsizedContent"].asBool();
+
+    // limits on reassembling received chunked messages
+    if (config["maxChunkedMessageMb"].isIntegral()) 
+        mChunkingConfig.maxMessageBytes = config["maxChunkedMessageMb"].asUInt64() * 1024 * 1024ull;
+    if (config["maxReassemblyMb"].isIntegral()) 
+        mChunkingConfig.maxReassemblyBytes = config["maxReassemblyMb"].asUInt64() * 1024 * 1024ull;
+    if (config["reassemblyTimeoutSecs"].isIntegral()) 
+        mChunkingConfig.reassemblyTimeout = std::chrono::seconds(config["reassemblyTimeoutSecs"].asInt());
+}
+
+namespace {
+
+// read limits for one dispatcher queue, e.g.
+//   "outgoingQueue": { "maxMessages": 1000, "maxMb": 512,
+//                      "lowWatermarkPercent": 50, "overflow": "block" }
+// "overflow" is one of "block", "dropOldest" or "reject", defaulting
+// to 'defaultPolicy'
+QueueLimits queueLimitsFromConfig(api::ObjectConstRef obj,
+                                  OverflowPolicy defaultPolicy)
+{
+    QueueLimits limits;
+    limits.policy = defaultPolicy;
+    if (!obj.isObject())
+        return limits;
+    if (obj["maxMessages"].isIntegral() && obj["maxMessages"].asInt() > 0)
+        limits.maxItems = obj["maxMessages"].asInt();
+    if (obj["maxMb"].isIntegral() && obj["maxMb"].asInt() > 0)
+        limits.maxBytes = obj["maxMb"].asInt() * 1024 * 1024ull;
+    if (obj["maxBytes"].isIntegral() && obj["maxBytes"].asInt() > 0)
+        limits.maxBytes += obj["maxBytes"].asInt();
+    if (obj["lowWatermarkPercent"].isIntegral() &&
+        obj["lowWatermarkPercent"].asInt() >= 0)
+        limits.lowWatermarkPercent = obj["lowWatermarkPercent"].asInt();
+    if (obj["overflow"].isString() &&
+        !overflowPolicyFromString(obj["overflow"].asString(), limits.policy)) {
+        ARRAS_WARN(log::Id("badQueueConfig") << "Unknown queue overflow policy '" <<
+                   obj["overflow"].asString() << "' : using '" <<
+                   overflowPolicyAsString(defaultPolicy) << "'");
+    }
+    return limits;
+}
+
+}
+
+// computation may ask for onMessage to be called on a pool of threads
+void
+CompEnvironmentImpl::applyHandlerPoolProperties(const ExecutionLimits& limits)
+{
+    api::Object threadsObj = mComputation->property(api::PropNames::handlerThreads);
+    if (!threadsObj.isIntegral() || threadsObj.asInt() <= 1)
+        return;
+    unsigned threads = threadsObj.asInt();
+    if (limits.maxThreads() > 0 && threads > limits.maxThreads())
+        threads = limits.maxThreads();
+
+    HandlerOrdering ordering = HandlerOrdering::Sender;
+    api::Object orderingObj = mComputation->property(api::PropNames::handlerOrdering);
+    if (orderingObj.isString()) {
+        std::string name = orderingObj.asString();
+        if (name == "sourceId")
+            ordering = HandlerOrdering::SourceId;
+        else if (name == "routingName")
+            ordering = HandlerOrdering::RoutingName;
+        else if (name != "sender")
+            ARRAS_WARN(log::Id("badHandlerOrdering") << "Unknown handler ordering '" <<
+                       name << "' : using 'sender'");
+    }
+    ARRAS_DEBUG("Computation messages will be handled on " << threads << " threads");
+    mDispatcher.setHandlerPool(threads,ordering);
+}
+
+// computation may opt out of onIdle calls. Otherwise config can change
+// the limit on idle backoff
+void
+CompEnvironmentImpl::applyIdleProperties(api::ObjectConstRef config)
+{
+    api::Object wantsIdle = mComputation->property(api::PropNames::wantsIdle);
+    if (wantsIdle.isBool() && !wantsIdle.asBool()) {
+        mDispatcher.setIdleInterval(MessageDispatcher::NO_IDLE,
+                                    MessageDispatcher::NO_IDLE);
+        return;
+    }
+    long maxInterval = COMPUTATION_MAX_IDLE_INTERVAL;
+    if (config["maxIdleIntervalMs"].isIntegral() &&
+        config["maxIdleIntervalMs"].asInt() >= 0)
+        maxInterval = config["maxIdleIntervalMs"].asInt() * 1000l;
+    mDispatcher.setIdleInterval(std::chrono::microseconds(COMPUTATION_IDLE_INTERVAL),
+                                std::chrono::microseconds(maxInterval));
+}
+
+// allow config to select the dispatcher queue implementation,
+// and to bound the queues
+void
+CompEnvironmentImpl::applyQueueConfig(api::ObjectRef config)
+{
+    // blocking the incoming queue would stop the reader thread
+    // receiving control messages (see MessageDispatcher.h)
+    QueueLimits incoming = queueLimitsFromConfig(config["incomingQueue"],
+                                                 OverflowPolicy::DropOldest);
+    if (incoming.policy == OverflowPolicy::Block) {
+        ARRAS_WARN(log::Id("badQueueConfig") << "The incoming queue cannot use overflow policy 'block' : "
+                   "using 'dropOldest'");
+        incoming.policy = OverflowPolicy::DropOldest;
+    }
+    QueueLimits outgoing = queueLimitsFromConfig(config["outgoingQueue"],
+                                                 OverflowPolicy::Block);
+    bool limited = incoming.isLimited() || outgoing.isLimited();
+
+    if (config["lockFreeQueues"].isBool() &&
+        config["lockFreeQueues"].asBool()) {
+        if (limited) {
+            ARRAS_WARN(log::Id("badQueueConfig") << "Bounded queues cannot be lock-free : "
+                       "ignoring 'lockFreeQueues'");
+        } else {
+            size_t capacity = DEFAULT_LOCKFREE_QUEUE_CAPACITY;
+            if (config["queueCapacity"].isIntegral() &&
+                config["queueCapacity"].asInt() > 0)
+                capacity = config["queueCapacity"].asInt();
+            mDispatcher.setQueueMode(QueueMode::LockFree,capacity);
+        }
+    }
+    if (limited)
+        mDispatcher.setQueueLimits(incoming,outgoing);
 }
     
 ComputationExitReason 
@@ -226,7 +365,7 @@ CompEnvironmentImpl::runComputation(MessageEndpoint& source,
 
     // send a special "ready" message to node to announce our connection
     impl::Envelope envelope(new ControlMessage("ready"));
-    envelope.to().push_back(to);
+    envelope.addTo(to);
     envelope.metadata()->from() = mAddress;
     mDispatcher.send(envelope);
  
@@ -22,6 +22,10 @@ namespace {
     // measured from the return of the previous onIdle to the call
     // to the next).
     constexpr long COMPUTATION_IDLE_INTERVAL = 40;
+    // if the Computation reports that onIdle had nothing to do (by setting
+    // the 'arras.idleNoWork' environment variable), the interval is doubled
+    // on each call, up to this maximum
+    constexpr long COMPUTATION_MAX_IDLE_INTERVAL = 50000;
 }
 
 namespace arras4 {
@@ -65,7 +69,7 @@ public:
     // MessageHandler interface deals with messages coming in
     // to the computation
     void handleMessage(const api::Message& message);
-    void onIdle();
+    bool onIdle();
 
     // Controlled interface deals with control messages 
     // (e.g "go", "stop") intercepted by the ControlMessageEndpoint
@@ -93,6 +97,9 @@ public:
 private:
 
     void applyChunkingConfig(api::ObjectRef config);
+    void applyQueueConfig(api::ObjectRef config);
+    void applyHandlerPoolProperties(const ExecutionLimits& limits);
+    void applyIdleProperties(api::ObjectConstRef config);
     ComputationExitReason waitForGoSignal();
 
     std::string mName;
@@ -104,6 +111,7 @@ private:
     mutable std::mutex mGoMutex;     
     std::condition_variable mGoCondition;
     bool mGo;
+    bool mIdleNoWork = false;
 
     ChunkingConfig mChunkingConfig;
 
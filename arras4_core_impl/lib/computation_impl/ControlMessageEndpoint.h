@@ -43,6 +43,10 @@ public:
     Envelope getEnvelope();
     void putEnvelope(const Envelope& env) { mSource.putEnvelope(env); }
     void shutdown() { mSource.shutdown(); }
+    void setFrameGapCallback(const FrameGapCallback& callback)
+        { mSource.setFrameGapCallback(callback); }
+    void beginBatch() { mSource.beginBatch(); }
+    void endBatch() { mSource.endBatch(); }
 
 private:
     bool processControlMessage(const Envelope& env);
@@ -5,8 +5,10 @@
 
 #include <shared_impl/MessageDispatcher.h>
 #include <shared_impl/ExecutionLimits.h>
+#include <shared_impl/Histogram.h>
 #include <message_impl/Envelope.h>
 #include <arras4_log/Logger.h>
+#include <arras4_log/LogEventStream.h>
 #include <core_messages/ExecutorHeartbeat.h>
 
 #include <unistd.h>
@@ -69,6 +71,17 @@ size_t getMemUsage()
     return memoryUsagePages * 4096; 
 }
 
+// values recorded in 'histogram' since 'last', which is then updated
+arras4::impl::HistogramSnapshot interval(const arras4::impl::Histogram& histogram,
+                                         arras4::impl::HistogramSnapshot& last)
+{
+    arras4::impl::HistogramSnapshot current = histogram.snapshot();
+    arras4::impl::HistogramSnapshot diff = current;
+    diff.subtract(last);
+    last = current;
+    return diff;
+}
+
 } // namespace {
 
 namespace arras4 {
@@ -98,6 +111,8 @@ void PerformanceMonitor::run()
     unsigned long lastReceivedMessages = 0;
     unsigned long sentMessages[12];
     unsigned long receivedMessages[12];
+    HistogramSnapshot lastLatency[DISPATCH_STAGE_COUNT];
+    HistogramSnapshot lastDepth[DISPATCH_STAGE_COUNT];
 
     // clear out the times
     for (int i=0; i< 12; i++) {
@@ -167,10 +182,38 @@ void PerformanceMonitor::run()
         heartbeat->mReceivedMessages5Sec = intervalReceivedMessages;
         heartbeat->mReceivedMessages60Sec = oneMinuteReceivedMessages;
         heartbeat->mReceivedMessagesTotal = totalReceivedMessages;
+
+        // queueing and handling statistics
+        HistogramSnapshot latency[DISPATCH_STAGE_COUNT];
+        HistogramSnapshot depth[DISPATCH_STAGE_COUNT];
+        for (size_t i = 0; i < DISPATCH_STAGE_COUNT; i++) {
+            DispatchStage stage = static_cast<DispatchStage>(i);
+            latency[i] = interval(mDispatcher.latencyHistogram(stage), lastLatency[i]);
+            depth[i] = interval(mDispatcher.depthHistogram(stage), lastDepth[i]);
+        }
+        const HistogramSnapshot& incoming = latency[static_cast<size_t>(DispatchStage::Incoming)];
+        const HistogramSnapshot& handler = latency[static_cast<size_t>(DispatchStage::Handler)];
+        const HistogramSnapshot& outgoing = latency[static_cast<size_t>(DispatchStage::Outgoing)];
+        heartbeat->mIncomingLatencyP50 = incoming.percentile(50);
+        heartbeat->mIncomingLatencyP99 = incoming.percentile(99);
+        heartbeat->mIncomingLatencyMax = incoming.max();
+        heartbeat->mHandlerLatencyP50 = handler.percentile(50);
+        heartbeat->mHandlerLatencyP99 = handler.percentile(99);
+        heartbeat->mHandlerLatencyMax = handler.max();
+        heartbeat->mOutgoingLatencyP50 = outgoing.percentile(50);
+        heartbeat->mOutgoingLatencyP99 = outgoing.percentile(99);
+        heartbeat->mOutgoingLatencyMax = outgoing.max();
+        heartbeat->mIncomingQueueDepthMax = depth[static_cast<size_t>(DispatchStage::Incoming)].max();
+        heartbeat->mOutgoingQueueDepthMax = depth[static_cast<size_t>(DispatchStage::Outgoing)].max();
+
+        ARRAS_DEBUG("Dispatch latency(us) over the last 5 seconds : " <<
+                    "incoming [" << incoming.describe() << "] " <<
+                    "handler [" << handler.describe() << "] " <<
+                    "outgoing [" << outgoing.describe() << "]");
         
         Envelope env(heartbeat);
         env.metadata()->from() = mFromAddress;
-        env.to() = mToList;
+        env.setTo(mToList);
         mDispatcher.send(env);
 
         // wait for 5 seconds before next iteration, unless
@@ -8,6 +8,7 @@
 #include <mutex>
 #include <message_api/Address.h>
 #include <message_api/messageapi_types.h>
+#include <message_impl/Envelope.h>
 
 namespace {
     constexpr size_t ONE_MB = 1000000;
@@ -30,7 +31,8 @@ public:
                        const api::AddressList& to)
         : mLimits(limits),
           mDispatcher(dispatcher), mRun(false),
-          mFromAddress(from), mToList(to)
+          mFromAddress(from), 
+          mToList(std::make_shared<const api::AddressList>(to))
         {}
 
     void run();
@@ -44,7 +46,7 @@ private:
     std::mutex mRunMutex;
     std::condition_variable mRunCondition;
     const api::Address mFromAddress;
-    const api::AddressList mToList;
+    const AddressListConstPtr mToList;
 };
 }
 }
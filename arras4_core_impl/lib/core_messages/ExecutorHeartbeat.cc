@@ -22,10 +22,15 @@ void ExecutorHeartbeat::serialize(api::DataOutStream& to) const
     to << mReceivedMessages5Sec << mReceivedMessages60Sec << mReceivedMessagesTotal;
 
     to << mStatus;
+
+    to << mIncomingLatencyP50 << mIncomingLatencyP99 << mIncomingLatencyMax;
+    to << mHandlerLatencyP50 << mHandlerLatencyP99 << mHandlerLatencyMax;
+    to << mOutgoingLatencyP50 << mOutgoingLatencyP99 << mOutgoingLatencyMax;
+    to << mIncomingQueueDepthMax << mOutgoingQueueDepthMax;
 }
 
 void ExecutorHeartbeat::deserialize(api::DataInStream& from, 
-                                 unsigned /*version*/)
+                                 unsigned version)
 {
     from >> mTransmitSecs >> mTransmitMicroSecs;
 
@@ -39,6 +44,13 @@ void ExecutorHeartbeat::deserialize(api::DataInStream& from,
     from >> mReceivedMessages5Sec >> mReceivedMessages60Sec >> mReceivedMessagesTotal;
 
     from >> mStatus;
+
+    if (version >= 1) {
+        from >> mIncomingLatencyP50 >> mIncomingLatencyP99 >> mIncomingLatencyMax;
+        from >> mHandlerLatencyP50 >> mHandlerLatencyP99 >> mHandlerLatencyMax;
+        from >> mOutgoingLatencyP50 >> mOutgoingLatencyP99 >> mOutgoingLatencyMax;
+        from >> mIncomingQueueDepthMax >> mOutgoingQueueDepthMax;
+    }
 }
 
 }
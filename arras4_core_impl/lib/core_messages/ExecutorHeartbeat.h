@@ -14,7 +14,7 @@ class ExecutorHeartbeat : public arras4::api::ObjectContent
 {
 public:
 
-    ARRAS_CONTENT_CLASS(ExecutorHeartbeat,"92c7ab1d-21a4-4cfe-a9fd-bd541436c15d",0);
+    ARRAS_CONTENT_CLASS(ExecutorHeartbeat,"92c7ab1d-21a4-4cfe-a9fd-bd541436c15d",1);
     
     ExecutorHeartbeat() :
         mTransmitSecs(0),
@@ -30,7 +30,18 @@ public:
         mSentMessagesTotal(0),
         mReceivedMessages5Sec(0),
         mReceivedMessages60Sec(0),
-        mReceivedMessagesTotal(0)
+        mReceivedMessagesTotal(0),
+        mIncomingLatencyP50(0),
+        mIncomingLatencyP99(0),
+        mIncomingLatencyMax(0),
+        mHandlerLatencyP50(0),
+        mHandlerLatencyP99(0),
+        mHandlerLatencyMax(0),
+        mOutgoingLatencyP50(0),
+        mOutgoingLatencyP99(0),
+        mOutgoingLatencyMax(0),
+        mIncomingQueueDepthMax(0),
+        mOutgoingQueueDepthMax(0)
        {}
   
     ~ExecutorHeartbeat() {}
@@ -62,6 +73,21 @@ public:
 
     // optional computation status
     std::string mStatus;
+
+    // dispatcher statistics for the messages handled and sent
+    // in the last 5 seconds (see DispatchStage). Latencies are in
+    // microseconds. Version 1 and later
+    uint64_t mIncomingLatencyP50;
+    uint64_t mIncomingLatencyP99;
+    uint64_t mIncomingLatencyMax;
+    uint64_t mHandlerLatencyP50;
+    uint64_t mHandlerLatencyP99;
+    uint64_t mHandlerLatencyMax;
+    uint64_t mOutgoingLatencyP50;
+    uint64_t mOutgoingLatencyP99;
+    uint64_t mOutgoingLatencyMax;
+    uint64_t mIncomingQueueDepthMax;
+    uint64_t mOutgoingQueueDepthMax;
 };
 
 }
@@ -0,0 +1,32 @@
+// Copyright 2023-2024 DreamWorks Animation LLC and Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __ARRAS4_QUEUE_FULL_EXCEPTION_H__
+#define __ARRAS4_QUEUE_FULL_EXCEPTION_H__
+
+#include <exception>
+#include <stddef.h>
+#include <string>
+
+namespace arras4 {
+    namespace impl {
+
+// thrown by a bounded queue using OverflowPolicy::Reject
+// when an item is pushed while the queue is full
+
+class QueueFullException : public std::exception
+{
+public:
+    QueueFullException(const std::string& detail)
+        : mMsg(detail) {}
+  
+    ~QueueFullException() {}
+    const char* what() const throw() { return mMsg.c_str(); }
+
+protected:
+    std::string mMsg;
+};
+
+}
+}
+#endif
@@ -0,0 +1,47 @@
+// Copyright 2023-2024 DreamWorks Animation LLC and Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "CountingOutStream.h"
+
+#include <message_api/ObjectContent.h>
+#include <message_api/UUID.h>
+#include <message_api/ArrasTime.h>
+#include <message_api/Address.h>
+
+namespace arras4
+{
+    namespace impl {
+
+size_t CountingOutStream::measure(const api::ObjectContent& content)
+{
+    size_t length = content.serializedLength();
+    if (length == 0)
+        length = exactSize(content);
+    return length;
+}
+
+size_t CountingOutStream::exactSize(const api::ObjectContent& content)
+{
+    CountingOutStream counter;
+    content.serialize(counter);
+    return counter.bytesWritten();
+}
+
+// strings have a length field (unsigned int or size_t) followed
+// by the characters : see StreamImpl.cc
+size_t CountingOutStream::write(const std::string& aString)
+{
+    return count(sizeof(unsigned int) + aString.length());
+}
+
+size_t CountingOutStream::writeLongString(const std::string& aString)
+{
+    return count(sizeof(size_t) + aString.length());
+}
+
+size_t CountingOutStream::write(const api::UUID& val)      { return count(sizeof(val)); }
+size_t CountingOutStream::write(const api::ArrasTime& val) { return count(sizeof(val)); }
+size_t CountingOutStream::write(const api::Address& val)   { return count(sizeof(val)); }
+
+}
+}
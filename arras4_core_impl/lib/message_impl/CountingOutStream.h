@@ -0,0 +1,69 @@
+// Copyright 2023-2024 DreamWorks Animation LLC and Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __ARRAS_COUNTINGOUTSTREAM_H__
+#define __ARRAS_COUNTINGOUTSTREAM_H__
+
+#include <message_api/DataOutStream.h>
+#include <message_api/messageapi_types.h>
+
+namespace arras4
+{
+    namespace impl {
+
+// A DataOutStream that stores nothing, but counts the bytes that
+// would be written. Running ObjectContent::serialize() into one of these
+// gives the exact serialized size of any content, so that destination
+// buffers can be sized up front, and chunking can be decided for content
+// that doesn't implement serializedLength().
+//
+// The encoding must match OutStreamImpl.
+class CountingOutStream final : public api::DataOutStream
+{
+public:
+    // serialized size of 'content' : uses content.serializedLength()
+    // if it is implemented, otherwise counts a serialize() pass.
+    // serializedLength() is only a hint, so use exactSize() if the
+    // size must match what is written
+    static size_t measure(const api::ObjectContent& content);
+
+    // serialized size of 'content', always found by counting 
+    // a serialize() pass
+    static size_t exactSize(const api::ObjectContent& content);
+
+    size_t write(const void*, size_t aLen) { return count(aLen); }
+    size_t fill(unsigned char,size_t aCount) { return count(aCount); }
+    void flush() {}
+    size_t bytesWritten() const { return mCount; }
+
+    size_t write(bool val)                   { return count(sizeof(val)); }
+    size_t write(int8_t val)                 { return count(sizeof(val)); }
+    size_t write(int16_t val)                { return count(sizeof(val)); }
+    size_t write(int32_t val)                { return count(sizeof(val)); }
+    size_t write(int64_t val)                { return count(sizeof(val)); }
+    size_t write(uint8_t val)                { return count(sizeof(val)); }
+    size_t write(uint16_t val)               { return count(sizeof(val)); }
+    size_t write(uint32_t val)               { return count(sizeof(val)); }
+    size_t write(uint64_t val)               { return count(sizeof(val)); }
+    size_t write(float val)                  { return count(sizeof(val)); }
+    size_t write(double val)                 { return count(sizeof(val)); }
+    size_t write(const std::string& aString);
+    size_t writeLongString(const std::string& aString);
+    size_t write(const api::UUID& uuid);
+    size_t write(const api::ArrasTime& time);
+    size_t write(const api::Address& address);
+#ifdef PLATFORM_APPLE
+    size_t write(unsigned long val)          { return count(sizeof(val)); }
+#endif
+    size_t writeStrided(const void*, size_t aElemSize,
+                        size_t aCount, size_t) { return count(aElemSize * aCount); }
+
+private:
+    size_t count(size_t aLen) { mCount += aLen; return aLen; }
+
+    size_t mCount = 0;
+};
+
+}
+}
+#endif
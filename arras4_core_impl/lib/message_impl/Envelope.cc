@@ -2,13 +2,18 @@
 // SPDX-License-Identifier: Apache-2.0
 
 #include "Envelope.h"
+#include "CountingOutStream.h"
+#include "OpaqueContent.h"
 
 #include <message_api/DataOutStream.h>
 #include <message_api/DataInStream.h>
+#include <message_api/ObjectContent.h>
 
 namespace arras4 { 
     namespace impl {
 
+const api::AddressList Envelope::sNoAddresses;
+
 const api::ClassID& Envelope::classId() const
 {
     if (content())
@@ -20,7 +25,7 @@ const api::ClassID& Envelope::classId() const
 void Envelope::serialize(api::DataOutStream& to) const 
 { 
     if (mMetadata) 
-        mMetadata->serialize(to,mTo); 
+        mMetadata->serialize(to,this->to()); 
     to << classId() << classVersion();
 }
        
@@ -28,14 +33,53 @@ void Envelope::deserialize(api::DataInStream& from,
                            api::ClassID& classId,
                            unsigned& version)
 { 
-    if (mMetadata) 
-        mMetadata->deserialize(from,mTo); 
+    if (mMetadata) {
+        api::AddressList destinations;
+        mMetadata->deserialize(from,destinations); 
+        if (destinations.empty())
+            mTo.reset();
+        else
+            mTo = std::make_shared<const api::AddressList>(std::move(destinations));
+    }
     from >> classId >> version;
 }
 
+void Envelope::setTo(const api::AddressList& to)
+{
+    if (to.empty())
+        mTo.reset();
+    else
+        mTo = std::make_shared<const api::AddressList>(to);
+}
+
+void Envelope::addTo(const api::Address& addr)
+{
+    std::shared_ptr<api::AddressList> to = 
+        std::make_shared<api::AddressList>(this->to());
+    to->push_back(addr);
+    mTo = std::move(to);
+}
+
+size_t Envelope::byteSize() const
+{
+    if (mByteSize == 0 && mContent) {
+        const OpaqueContent* opaque =
+            dynamic_cast<const OpaqueContent*>(mContent.get());
+        const api::ObjectContent* object =
+            dynamic_cast<const api::ObjectContent*>(mContent.get());
+        if (opaque && opaque->dataBuffer())
+            mByteSize = opaque->dataBuffer()->remaining();
+        else if (object)
+            mByteSize = CountingOutStream::measure(*object);
+    }
+    return mByteSize;
+}
+
 void Envelope::clear()
 {
-    mTo = api::AddressList();
+    mByteSize = 0;
+    mQueuedTime = Clock::time_point();
+    mTo.reset();
     mMetadata.reset();
     mContent.reset();
 }
@@ -9,9 +9,17 @@
 
 #include "MetadataImpl.h"
 
+#include <chrono>
+
 namespace arras4 {
     namespace impl {
 
+// destination lists are immutable once they are given to an envelope,
+// so they can be shared. Most messages from a computation go to the same
+// few destinations, and Addressing keeps a list for each of them, so
+// addressing a message just takes a reference
+using AddressListConstPtr = std::shared_ptr<const api::AddressList>;
+
 class Envelope
 {
 public:
@@ -21,9 +29,8 @@ public:
              api::ObjectConstRef& options = api::Object(),
              const api::AddressList& to = api::AddressList())
         : mContent(content),
-          mMetadata(new MetadataImpl(content,options)),
-          mTo(to)
-        {}
+          mMetadata(new MetadataImpl(content,options))
+        { setTo(to); }
 
     explicit Envelope(const api::MessageContent* content, // note handover
              api::ObjectConstRef& options = api::Object(),
@@ -35,9 +42,9 @@ public:
 
     const api::MessageContentConstPtr& content() const { return mContent; }
     void setContent(const api::MessageContentConstPtr& content)
-        { mContent = content; }
+        { mContent = content; mByteSize = 0; }
     void setContent(const api::MessageContent* content) // note handover
-        { mContent = api::MessageContentConstPtr(content); }
+        { mContent = api::MessageContentConstPtr(content); mByteSize = 0; }
     
     template<typename T> std::shared_ptr<const T> contentAs() const
         { return std::dynamic_pointer_cast<const T>(mContent); }
@@ -56,10 +63,12 @@ public:
         else return "[Empty Message]";
     }
 
-    const api::AddressList& to() const { return mTo; }
-    api::AddressList& to() { return mTo; }
-    void addTo(const api::Address& addr) { mTo.push_back(addr); }
-    void clearTo() { mTo.clear(); }
+    const api::AddressList& to() const { return mTo ? *mTo : sNoAddresses; }
+    const AddressListConstPtr& toList() const { return mTo; }
+    void setTo(const AddressListConstPtr& to) { mTo = to; }
+    void setTo(const api::AddressList& to); // copies 'to'
+    void addTo(const api::Address& addr);   // copies the current list
+    void clearTo() { mTo.reset(); }
 
     api::Message makeMessage() { return api::Message(mMetadata,mContent); }
 
@@ -74,11 +83,29 @@ public:
 
     bool isEmpty() const { return !mContent; }
 
+    // approximate size of the message in bytes, used to bound
+    // message queues. For a received message this is the frame size,
+    // set by MessageReader. Otherwise the content is measured on the
+    // first call, and the result is kept
+    size_t byteSize() const;
+    void setByteSize(size_t size) { mByteSize = size; }
+
+    // when the message was placed on a dispatcher queue, used to
+    // measure queueing latency. Zero (the clock's epoch) if it hasn't
+    // been queued
+    using Clock = std::chrono::steady_clock;
+    const Clock::time_point& queuedTime() const { return mQueuedTime; }
+    void stampQueued() { mQueuedTime = Clock::now(); }
+
 private:
 
     api::MessageContentConstPtr mContent;
     MetadataImpl::Ptr mMetadata;
-    api::AddressList mTo;
+    AddressListConstPtr mTo; // null if there are no destinations
+    mutable size_t mByteSize = 0;
+    Clock::time_point mQueuedTime;
+
+    static const api::AddressList sNoAddresses;
 };
 
     }
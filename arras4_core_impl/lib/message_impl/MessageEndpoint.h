@@ -7,6 +7,8 @@
 #include "Envelope.h"
 #include <message_api/messageapi_types.h>
 
+#include <functional>
+
 namespace arras4 {
     namespace impl {
 
@@ -18,6 +20,20 @@ public:
     virtual Envelope getEnvelope()=0;
     virtual void putEnvelope(const Envelope&)=0;
     virtual void shutdown()=0;
+
+    // endpoints that send a message as several frames (e.g.
+    // ChunkingMessageEndpoint) call the frame gap callback between
+    // frames, on the thread calling putEnvelope(). This lets the caller
+    // send urgent messages without waiting for the whole of a large
+    // message to go out
+    using FrameGapCallback = std::function<void()>;
+    virtual void setFrameGapCallback(const FrameGapCallback&) {}
+
+    // putEnvelope() calls between beginBatch() and endBatch() may be
+    // coalesced into fewer writes. endBatch() sends anything still
+    // pending
+    virtual void beginBatch() {}
+    virtual void endBatch() {}
 };
 
 }
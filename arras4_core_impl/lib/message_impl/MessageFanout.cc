@@ -0,0 +1,82 @@
+// Copyright 2023-2024 DreamWorks Animation LLC and Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "MessageFanout.h"
+#include "CountingOutStream.h"
+#include "MessageEndpoint.h"
+#include "StreamImpl.h"
+
+#include <exceptions/InternalError.h>
+
+#include <message_api/ObjectContent.h>
+#include <message_api/MessageFormatError.h>
+
+#include <network/Buffer.h>
+
+namespace arras4 {
+    namespace impl {
+
+MessageFanout::MessageFanout(const Envelope& envelope)
+    : mEnvelope(envelope),
+      mContent(serialize(envelope.content()))
+{
+    mEnvelope.setContent(mContent);
+}
+
+OpaqueContent::ConstPtr
+MessageFanout::serialize(const api::MessageContentConstPtr& content)
+{
+    OpaqueContent::ConstPtr opaque =
+        std::dynamic_pointer_cast<const OpaqueContent>(content);
+    if (opaque)
+        return opaque;
+
+    const api::ObjectContent* object =
+        dynamic_cast<const api::ObjectContent*>(content.get());
+    if (!object)
+        throw api::MessageFormatError(
+            "Unknown message content format : Object or Opaque content expected");
+
+    // the buffer is sized exactly, so there is no copy or reallocation
+    // however large the content is. serializedLength() is only a hint,
+    // so the size is counted
+    size_t size = CountingOutStream::exactSize(*object);
+    std::shared_ptr<network::Buffer> buffer = std::make_shared<network::Buffer>(size);
+    {
+        OutStreamImpl stream(*buffer);
+        object->serialize(stream);
+        stream.flush();
+    }
+    if (buffer->remaining() != size)
+        throw InternalError("[MessageFanout] Serialized size doesn't match measured size");
+
+    return std::make_shared<const OpaqueContent>(object->classId(),
+                                                 object->classVersion(),
+                                                 buffer);
+}
+
+Envelope MessageFanout::envelopeTo(const AddressListConstPtr& to) const
+{
+    Envelope envelope(mEnvelope);
+    envelope.setTo(to);
+    return envelope;
+}
+
+void MessageFanout::put(MessageEndpoint& endpoint) const
+{
+    endpoint.putEnvelope(mEnvelope);
+}
+
+void MessageFanout::put(MessageEndpoint& endpoint,
+                        const AddressListConstPtr& to) const
+{
+    endpoint.putEnvelope(envelopeTo(to));
+}
+
+size_t MessageFanout::contentSize() const
+{
+    return mContent->dataBuffer()->remaining();
+}
+
+}
+}
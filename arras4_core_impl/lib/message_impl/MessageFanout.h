@@ -0,0 +1,63 @@
+// Copyright 2023-2024 DreamWorks Animation LLC and Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __ARRAS4_MESSAGE_FANOUT_H__
+#define __ARRAS4_MESSAGE_FANOUT_H__
+
+#include "Envelope.h"
+#include "OpaqueContent.h"
+
+#include <message_api/messageapi_types.h>
+
+namespace arras4 {
+    namespace impl {
+
+class MessageEndpoint;
+
+// MessageFanout sends one message out to several endpoints (e.g. a
+// scene update broadcast to many computations) at the cost of a single
+// serialization.
+//
+// The content is serialized once, on construction, into an immutable
+// buffer that is shared by OpaqueContent. Each endpoint is then given an
+// envelope holding that OpaqueContent. MessageWriter appends the shared
+// buffer to the outgoing frame instead of copying it, and
+// ChunkingMessageEndpoint chunks it with views onto the buffer, so
+// each extra destination costs neither a serialization nor a copy of
+// the payload. Only the small metadata header is written per endpoint.
+//
+// The metadata is shared too, and must not be changed while the
+// message is being sent. A MessageFanout may be used from several
+// threads once it has been constructed.
+class MessageFanout
+{
+public:
+    // throws MessageFormatError if the content is neither ObjectContent
+    // nor OpaqueContent
+    explicit MessageFanout(const Envelope& envelope);
+
+    // write the message to 'endpoint', addressed to the original
+    // destinations, or to 'to'
+    void put(MessageEndpoint& endpoint) const;
+    void put(MessageEndpoint& endpoint, const AddressListConstPtr& to) const;
+
+    // the message with serialized content, addressed to the
+    // original destinations
+    const Envelope& envelope() const { return mEnvelope; }
+    Envelope envelopeTo(const AddressListConstPtr& to) const;
+
+    // serialized size of the content
+    size_t contentSize() const;
+
+    // returns OpaqueContent holding the serialized form of 'content'.
+    // OpaqueContent is returned unchanged, since it is already serialized
+    static OpaqueContent::ConstPtr serialize(const api::MessageContentConstPtr& content);
+
+private:
+    Envelope mEnvelope;
+    OpaqueContent::ConstPtr mContent;
+};
+
+}
+}
+#endif
@@ -79,6 +79,9 @@ Envelope MessageReader::read(bool useRegistry)
     // get the next frame from our source. This will be an
     // entire message.
    
+    // the stream may still hold a window from a previous
+    // frame if deserialization failed
+    mInStream.discard();
     size_t frameSize = mSource.nextFrame();
     if (frameSize == 0) {
         return Envelope(); // timeout
@@ -94,6 +97,7 @@ Envelope MessageReader::read(bool useRegistry)
     unsigned version;
     Envelope env;
     env.deserialize(mInStream,classId,version);
+    mInStream.sync();
 
     // a flag in the metadata indicates whether this message
     // should be traced
@@ -114,6 +118,7 @@ Envelope MessageReader::read(bool useRegistry)
             create(classId,version);
         if (objContent) {
             objContent->deserialize(mInStream,version);
+            mInStream.sync();
             if (trace) {
                 ARRAS_ATHENA_TRACE(0,log::Session(env.metadata()->from().session.toString()) <<
                                    "{trace:message} deserialized " << env.metadata()->instanceId().toString() << " "
@@ -146,6 +151,7 @@ Envelope MessageReader::read(bool useRegistry)
     
     mSource.endFrame();
     env.setContent(content);
+    env.setByteSize(frameSize);
     return env;
 }
  
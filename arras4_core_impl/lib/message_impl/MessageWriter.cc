@@ -72,6 +72,10 @@ void MessageWriter::write(const Envelope& env)
     // since it can fill in the size itself when it sends on the frame
     mSink.openFrame();
 
+    // the stream may still hold a window from a previous
+    // message if serialization failed
+    mOutStream.discard();
+
     // a flag in the metadata indicates whether this message
     // should be traced
     bool trace = env.metadata() && env.metadata()->trace();
@@ -109,6 +113,14 @@ void MessageWriter::write(const Envelope& env)
             // ObjectContent subclasses are serializable, so serialize
             // the object into our sink buffers right after the metadata, 
             // again using out DataOutStream wrapper
+            // if the content gives a size hint, size the sink buffers 
+            // up front so that large messages don't go through a series
+            // of doubling allocations. Without a hint, measuring would cost
+            // a second serialize() pass on every message, so the buffers
+            // are left to grow
+            size_t sizeHint = objectContent->serializedLength();
+            if (sizeHint > 0)
+                mSink.reserve(sizeHint);
             objectContent->serialize(mOutStream);
             mOutStream.flush(); 
         
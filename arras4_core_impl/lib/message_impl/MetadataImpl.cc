@@ -34,12 +34,12 @@ MetadataImpl::MetadataImpl(const api::MessageContentConstPtr& content,
     : MetadataImpl()
 {
     if (content)
-        mRoutingName = content->defaultRoutingName();
+        setRoutingName(content->defaultRoutingName());
     if (options[api::MessageOptions::sourceId].isString()) {
         mSourceId = api::UUID(options[api::MessageOptions::sourceId].asString());
     }
     if (options[api::MessageOptions::routingName].isString()) {
-        mRoutingName = options[api::MessageOptions::routingName].asString();
+        setRoutingName(options[api::MessageOptions::routingName].asString());
     }
 }
 
@@ -55,7 +55,7 @@ api::Object MetadataImpl::get(const std::string& optionName) const
         return ret;
     }
     if (optionName == api::MessageData::routingName) 
-        return mRoutingName;
+        return mRoutingName->str();
     if (optionName == api::MessageData::creationTimeSecs) 
         return mCreationTime.seconds;
     if (optionName == api::MessageData::creationTimeMicroSecs) 
@@ -72,7 +72,7 @@ void  MetadataImpl::toObject(api::ObjectRef obj)
     obj["creationTime"]["seconds"] = mCreationTime.seconds;
     obj["creationTime"]["microseconds"] =  mCreationTime.microseconds;
     mFrom.toObject(obj["from"]);
-    obj["routingName"] = mRoutingName;
+    obj["routingName"] = mRoutingName->str();
 }
 
 void MetadataImpl::fromObject(api::ObjectConstRef obj)
@@ -82,7 +82,7 @@ void MetadataImpl::fromObject(api::ObjectConstRef obj)
     mCreationTime.seconds =  obj["creationTime"]["seconds"].asInt();
     mCreationTime.microseconds =  obj["creationTime"]["seconds"].asInt();
     mFrom.fromObject(obj["from"]);
-    mRoutingName = obj["routingName"].asString();
+    setRoutingName(obj["routingName"].asString());
 }
 
 
@@ -105,11 +105,16 @@ void MetadataImpl::fromObject(api::ObjectConstRef obj)
 //
 // headerLength field is 42+len(routingName)    
 // full header size is 66 + len(routingName) + 48*addressCount
+//
+// The routing name is interned when it is read (see RoutingName.h), so
+// a name that has been seen before costs no allocation. RoutingIds
+// are local to a process and are not sent.
 
 void MetadataImpl::serialize(api::DataOutStream& to,
                              const api::AddressList& destinations) const
 {
-    uint16_t nameLen = static_cast<uint16_t>(mRoutingName.length());
+    const std::string& routingName = mRoutingName->str();
+    uint16_t nameLen = static_cast<uint16_t>(routingName.length());
     if (nameLen == 0)
         throw api::MessageFormatError("Routing name has zero length");
 
@@ -124,7 +129,7 @@ void MetadataImpl::serialize(api::DataOutStream& to,
     to << addrOffset << protocolVer << flags;
     to << mInstanceId << mSourceId << nameLen;
     if (nameLen > 0)
-        to.write(mRoutingName.c_str(),nameLen);
+        to.write(routingName.c_str(),nameLen);
 
     uint32_t nAddr = uint32_t(destinations.size() + 1);
     to << nAddr << mFrom;
@@ -156,10 +161,13 @@ void MetadataImpl::deserialize(api::DataInStream& from,
     uint16_t nameLen;
     from >> mInstanceId >> mSourceId >> nameLen;
     if (nameLen > 0) {
-        mRoutingName.resize(nameLen);
-        from.read(&mRoutingName.at(0),nameLen);
+        // scratch space reused by each read on this thread
+        thread_local std::string name;
+        name.resize(nameLen);
+        from.read(&name.at(0),nameLen);
+        mRoutingName = RoutingName::intern(name);
     } else {
-        mRoutingName.clear();
+        mRoutingName = RoutingName::empty();
     }
 
     // skip the 'extension' section, up to addrOffset
@@ -4,6 +4,8 @@
 #ifndef __ARRAS4_METADATA_IMPL_H__
 #define __ARRAS4_METADATA_IMPL_H__
 
+#include "RoutingName.h"
+
 #include <message_api/messageapi_types.h>
 #include <message_api/Message.h>
 #include <message_api/Metadata.h>
@@ -22,7 +24,12 @@ public:
     api::Object get(const std::string& optionName) const;
     void toObject(api::ObjectRef obj);
     void fromObject(api::ObjectConstRef obj);
-    std::string describe() const { return mRoutingName; }
+    std::string describe() const { return mRoutingName->str(); }
+    api::UUID getInstanceId() const { return mInstanceId; }
+    api::UUID getSourceId() const { return mSourceId; }
+    api::ArrasTime getCreationTime() const { return mCreationTime; }
+    api::Address getFrom() const { return mFrom; }
+    std::string getRoutingName() const { return mRoutingName->str(); }
 
     // implementation functions
     const api::UUID& instanceId() const { return mInstanceId; }
@@ -33,9 +40,13 @@ public:
     api::Address& from() { return mFrom; }
     void setFrom(const api::Address& addr) { mFrom = addr; }
   
-    const std::string& routingName() const { return mRoutingName; }
-    std::string& routingName() { return mRoutingName; }
-    void setRoutingName(const std::string& name) { mRoutingName = name; }
+    // routing names are interned, so routingId() can be used in place
+    // of the name for lookups within this process, unless it is
+    // UNINTERNED_ROUTING_ID (see RoutingName.h)
+    const std::string& routingName() const { return mRoutingName->str(); }
+    RoutingId routingId() const { return mRoutingName->id(); }
+    const RoutingName& routingNameSymbol() const { return *mRoutingName; }
+    void setRoutingName(const std::string& name) { mRoutingName = RoutingName::intern(name); }
   
     bool trace() const { return mTrace; }
     bool& trace() { return mTrace; }
@@ -57,7 +68,7 @@ private:
     api::UUID mSourceId;
     api::ArrasTime mCreationTime;
     api::Address mFrom;
-    std::string mRoutingName;
+    RoutingName::ConstPtr mRoutingName = RoutingName::empty();
     bool mTrace;
 };
 
@@ -55,6 +55,19 @@ void  PeerMessageEndpoint::putEnvelope(const Envelope& env)
     }
 }
 
+void PeerMessageEndpoint::endBatch()
+{
+    if (mShutdown)
+        throw ShutdownException("PeerMessageEndpoint was shut down");
+    try {
+        mFramedSink->endBatch();
+    } catch (network::PeerDisconnectException&) {
+        if (mShutdown)
+            throw ShutdownException("PeerMessageEndpoint was shut down");
+        else
+            throw;
+    }
+}
 
 void  PeerMessageEndpoint::shutdown() {
     // terminate any blocked calls to getEnvelope() or 
@@ -33,9 +33,16 @@ public:
     ~PeerMessageEndpoint() {}
     Envelope getEnvelope();
     void putEnvelope(const Envelope& env);
+    void beginBatch() { mFramedSink->beginBatch(); }
+    void endBatch();
     
     void shutdown(); 
 
+    // highest frame header version supported by the remote
+    // endpoint (see network/Frame.h). Set this to Frame::VERSION_LARGE 
+    // to allow messages over 4Gb to be sent as a single frame.
+    void setFrameVersion(unsigned version) { mFramedSink->setFrameVersion(version); }
+
     const MessageReader& reader() const { return mReader; }
     const MessageWriter& writer() const { return mWriter; }
     MessageReader& reader() { return mReader; }
@@ -0,0 +1,112 @@
+// Copyright 2023-2024 DreamWorks Animation LLC and Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "RoutingName.h"
+
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace arras4 {
+    namespace impl {
+
+// the table is created on first use, and deliberately never destroyed,
+// so that names stay valid during static destruction
+class RoutingNameTable
+{
+public:
+    static RoutingNameTable& instance()
+    {
+        static RoutingNameTable* table = new RoutingNameTable;
+        return *table;
+    }
+
+    RoutingNameTable()
+    {
+        add(std::string_view());
+    }
+
+    RoutingName::ConstPtr intern(std::string_view name)
+    {
+        {
+            std::shared_lock<std::shared_mutex> lock(mMutex);
+            auto it = mByName.find(name);
+            if (it != mByName.end())
+                return unowned(it->second);
+        }
+        std::unique_lock<std::shared_mutex> lock(mMutex);
+        auto it = mByName.find(name);
+        if (it != mByName.end())
+            return unowned(it->second);
+        if (mNames.size() < MAX_ROUTING_NAMES)
+            return unowned(&add(name));
+        lock.unlock();
+
+        // the table is full : this name belongs to the caller alone
+        return RoutingName::ConstPtr(
+            new RoutingName(std::string(name), UNINTERNED_ROUTING_ID,
+                            std::hash<std::string_view>()(name), false));
+    }
+
+    const RoutingName* find(std::string_view name)
+    {
+        std::shared_lock<std::shared_mutex> lock(mMutex);
+        auto it = mByName.find(name);
+        return it == mByName.end() ? nullptr : it->second;
+    }
+
+    const RoutingName& empty() const { return *mNames.front(); }
+
+    // interned names are never deleted, so the pointer has no
+    // control block
+    static RoutingName::ConstPtr unowned(const RoutingName* name)
+    {
+        return RoutingName::ConstPtr(RoutingName::ConstPtr(), name);
+    }
+
+private:
+    // caller holds an exclusive lock, or is the constructor
+    const RoutingName& add(std::string_view name)
+    {
+        RoutingId id = static_cast<RoutingId>(mNames.size());
+        mNames.emplace_back(new RoutingName(std::string(name), id,
+                                            std::hash<std::string_view>()(name),
+                                            true));
+        const RoutingName* routingName = mNames.back().get();
+        // the key refers to the interned string, which never moves
+        mByName.emplace(std::string_view(routingName->str()), routingName);
+        return *routingName;
+    }
+
+    std::shared_mutex mMutex;
+    std::vector<std::unique_ptr<const RoutingName>> mNames;
+    std::unordered_map<std::string_view, const RoutingName*> mByName;
+};
+
+RoutingName::ConstPtr RoutingName::intern(const std::string& name)
+{
+    return RoutingNameTable::instance().intern(name);
+}
+
+RoutingName::ConstPtr RoutingName::intern(const char* data, size_t length)
+{
+    return RoutingNameTable::instance().intern(std::string_view(data, length));
+}
+
+const RoutingName* RoutingName::find(const std::string& name)
+{
+    return RoutingNameTable::instance().find(name);
+}
+
+const RoutingName::ConstPtr& RoutingName::empty()
+{
+    static const ConstPtr name = 
+        RoutingNameTable::unowned(&RoutingNameTable::instance().empty());
+    return name;
+}
+
+}
+}
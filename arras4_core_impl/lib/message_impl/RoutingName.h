@@ -0,0 +1,79 @@
+// Copyright 2023-2024 DreamWorks Animation LLC and Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __ARRAS4_ROUTING_NAME_H__
+#define __ARRAS4_ROUTING_NAME_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace arras4 {
+    namespace impl {
+
+// compact id for an interned routing name, unique within the process.
+// Ids are not stable across processes, so they aren't sent on the wire
+using RoutingId = uint32_t;
+
+// maximum number of distinct routing names interned in a process. Names
+// arrive from peers, so this stops a misbehaving peer growing the table
+// without limit
+constexpr size_t MAX_ROUTING_NAMES = 65536;
+
+// id of the empty name, which is also given to names that couldn't be
+// interned. Lookups on this id have to compare str() as well
+constexpr RoutingId UNINTERNED_ROUTING_ID = 0;
+
+// RoutingName is an interned message routing name (i.e. a symbol).
+// There is only ever one interned RoutingName for a given string, and it
+// is never deleted, so routing tables can be keyed by id() rather than
+// by string. Interning a name that is already known doesn't allocate.
+//
+// Once MAX_ROUTING_NAMES have been interned, intern() returns a new,
+// un-interned RoutingName for each new name instead, with id 
+// UNINTERNED_ROUTING_ID. It is owned by the returned pointer, so the
+// table stays bounded and the message still carries its name.
+//
+// intern() and find() are threadsafe : other functions just read
+// immutable data.
+class RoutingName
+{
+public:
+    // pointers to interned names don't own them, and copying them
+    // doesn't touch a reference count
+    using ConstPtr = std::shared_ptr<const RoutingName>;
+
+    // returns the RoutingName for 'name', adding it if necessary
+    static ConstPtr intern(const std::string& name);
+    static ConstPtr intern(const char* data, size_t length);
+
+    // returns null if 'name' hasn't been interned
+    static const RoutingName* find(const std::string& name);
+
+    // the empty name, with id UNINTERNED_ROUTING_ID
+    static const ConstPtr& empty();
+
+    const std::string& str() const { return mName; }
+    RoutingId id() const { return mId; }
+    size_t hash() const { return mHash; }
+    bool interned() const { return mInterned; }
+
+    RoutingName(const RoutingName&) = delete;
+    RoutingName& operator=(const RoutingName&) = delete;
+
+private:
+    RoutingName(const std::string& name, RoutingId id, size_t hash,
+                bool interned)
+        : mName(name), mId(id), mHash(hash), mInterned(interned) {}
+
+    friend class RoutingNameTable;
+    const std::string mName;
+    const RoutingId mId;
+    const size_t mHash;
+    const bool mInterned;
+};
+
+}
+}
+#endif
@@ -10,6 +10,8 @@
 #include <message_api/ArrasTime.h>
 #include <message_api/Address.h>
 
+#include <algorithm>
+
 using namespace arras4::network;
 
 namespace arras4
@@ -21,19 +23,76 @@ InStreamImpl::InStreamImpl(DataSource& source)
 {
 }
 
+InStreamImpl::~InStreamImpl()
+{
+    sync();
+}
+
+void InStreamImpl::sync()
+{
+    if (mWindowStart) {
+        mSource.commitRead(mCursor - mWindowStart);
+        discard();
+    }
+}
+
+void InStreamImpl::discard()
+{
+    mWindowStart = mCursor = mWindowEnd = nullptr;
+}
+
+// called when the current window can't satisfy a read. Moves on to the
+// next window, or reads directly from the source if there isn't one
+size_t InStreamImpl::readSlow(unsigned char* aBuf, size_t aLen)
+{
+    size_t done = 0;
+    while (true) {
+        size_t n = std::min(aLen - done, static_cast<size_t>(mWindowEnd - mCursor));
+        if (n > 0) {
+            std::memcpy(aBuf + done, mCursor, n);
+            mCursor += n;
+            done += n;
+        }
+        if (done == aLen)
+            return done;
+        sync();
+        size_t available = 0;
+        const unsigned char* window = mSource.readWindow(available);
+        if (!window || available == 0) {
+            // source handles timeouts and errors
+            return done + mSource.read(aBuf + done, aLen - done);
+        }
+        mWindowStart = mCursor = window;
+        mWindowEnd = window + available;
+    }
+}
+
 size_t InStreamImpl::read(void* aBuf, size_t aLen)
 {
-    return mSource.read(reinterpret_cast<unsigned char*>(aBuf),aLen);
+    unsigned char* buf = reinterpret_cast<unsigned char*>(aBuf);
+    if (aLen == 0)
+        return 0;
+    if (static_cast<size_t>(mWindowEnd - mCursor) >= aLen) {
+        std::memcpy(buf, mCursor, aLen);
+        mCursor += aLen;
+        return aLen;
+    }
+    return readSlow(buf, aLen);
 }
  
 size_t InStreamImpl::skip(size_t aLen)
 {
+    if (static_cast<size_t>(mWindowEnd - mCursor) >= aLen) {
+        mCursor += aLen;
+        return aLen;
+    }
+    sync();
     return mSource.skip(aLen);
 }
 
 size_t InStreamImpl::bytesRead() const
 {
-    return mSource.bytesRead();
+    return mSource.bytesRead() + (mCursor - mWindowStart);
 }
 
 
@@ -42,68 +101,146 @@ OutStreamImpl::OutStreamImpl(DataSink& sink)
 {
 }
 
+OutStreamImpl::~OutStreamImpl()
+{
+    sync();
+}
+
+void OutStreamImpl::sync()
+{
+    if (mWindowStart) {
+        mSink.commitWrite(mCursor - mWindowStart);
+        discard();
+    }
+}
+
+void OutStreamImpl::discard()
+{
+    mWindowStart = mCursor = mWindowEnd = nullptr;
+}
+
+// called when the current window can't hold a write. Moves on to the
+// next window, or writes directly to the sink if there isn't one
+size_t OutStreamImpl::writeSlow(const unsigned char* aBuf, size_t aLen)
+{
+    size_t done = 0;
+    while (true) {
+        size_t n = std::min(aLen - done, static_cast<size_t>(mWindowEnd - mCursor));
+        if (n > 0) {
+            std::memcpy(mCursor, aBuf + done, n);
+            mCursor += n;
+            done += n;
+        }
+        if (done == aLen)
+            return done;
+        sync();
+        size_t available = 0;
+        unsigned char* window = mSink.writeWindow(available);
+        if (!window || available == 0) {
+            return done + mSink.write(aBuf + done, aLen - done);
+        }
+        mWindowStart = mCursor = window;
+        mWindowEnd = window + available;
+    }
+}
+
 size_t OutStreamImpl::write(const void* aBuf, size_t aLen)
 {
-    return mSink.write(reinterpret_cast<const unsigned char*>(aBuf),aLen);
+    const unsigned char* buf = reinterpret_cast<const unsigned char*>(aBuf);
+    if (aLen == 0)
+        return 0;
+    if (static_cast<size_t>(mWindowEnd - mCursor) >= aLen) {
+        std::memcpy(mCursor, buf, aLen);
+        mCursor += aLen;
+        return aLen;
+    }
+    return writeSlow(buf, aLen);
 }
    
 size_t OutStreamImpl::fill(unsigned char aByte,size_t aCount)
 {
     size_t filled = 0;
     for (size_t i = 0; i < aCount; i++)
-        filled += write(aByte);
+        filled += writeValue(aByte);
     return filled;
 }
  
 void OutStreamImpl::flush()
 {
+    sync();
     mSink.flush();
 }
   
 size_t OutStreamImpl::bytesWritten() const
 {
-    return mSink.bytesWritten();
+    return mSink.bytesWritten() + (mCursor - mWindowStart);
 }
 
 // Currently all types except strings are serialized using the internal memory 
 // representation of the C++ runtime. This assumes it is the same across all 
 // architectures we are using.
 
-size_t InStreamImpl::read(bool& val)               { return read(&val,sizeof(val)); }
-size_t InStreamImpl::read(int8_t& val)             { return read(&val,sizeof(val)); }
-size_t InStreamImpl::read(int16_t& val)            { return read(&val,sizeof(val)); }
-size_t InStreamImpl::read(int32_t& val)            { return read(&val,sizeof(val)); }
-size_t InStreamImpl::read(int64_t& val)            { return read(&val,sizeof(val)); }
-size_t InStreamImpl::read(uint8_t& val)            { return read(&val,sizeof(val)); }
-size_t InStreamImpl::read(uint16_t& val)           { return read(&val,sizeof(val)); }
-size_t InStreamImpl::read(uint32_t& val)           { return read(&val,sizeof(val)); }
-size_t InStreamImpl::read(uint64_t& val)           { return read(&val,sizeof(val)); }
-size_t InStreamImpl::read(float& val)              { return read(&val,sizeof(val)); }
-size_t InStreamImpl::read(double& val)             { return read(&val,sizeof(val)); }
-size_t InStreamImpl::read(api::UUID& val)          { return read(&val,sizeof(val)); }
-size_t InStreamImpl::read(api::ArrasTime& val)     { return read(&val,sizeof(val)); }
-size_t InStreamImpl::read(api::Address& val)       { return read(&val,sizeof(val)); }
+size_t InStreamImpl::read(bool& val)               { return readValue(val); }
+size_t InStreamImpl::read(int8_t& val)             { return readValue(val); }
+size_t InStreamImpl::read(int16_t& val)            { return readValue(val); }
+size_t InStreamImpl::read(int32_t& val)            { return readValue(val); }
+size_t InStreamImpl::read(int64_t& val)            { return readValue(val); }
+size_t InStreamImpl::read(uint8_t& val)            { return readValue(val); }
+size_t InStreamImpl::read(uint16_t& val)           { return readValue(val); }
+size_t InStreamImpl::read(uint32_t& val)           { return readValue(val); }
+size_t InStreamImpl::read(uint64_t& val)           { return readValue(val); }
+size_t InStreamImpl::read(float& val)              { return readValue(val); }
+size_t InStreamImpl::read(double& val)             { return readValue(val); }
+size_t InStreamImpl::read(api::UUID& val)          { return readValue(val); }
+size_t InStreamImpl::read(api::ArrasTime& val)     { return readValue(val); }
+size_t InStreamImpl::read(api::Address& val)       { return readValue(val); }
 #ifdef PLATFORM_APPLE
-size_t InStreamImpl::read(unsigned long& val)      { return read(&val,sizeof(val)); }
+size_t InStreamImpl::read(unsigned long& val)      { return readValue(val); }
 #endif
 
-size_t OutStreamImpl::write(bool val)                  { return write(&val,sizeof(val)); }
-size_t OutStreamImpl::write(int8_t val)                { return write(&val,sizeof(val)); }
-size_t OutStreamImpl::write(int16_t val)               { return write(&val,sizeof(val)); }
-size_t OutStreamImpl::write(int32_t val)               { return write(&val,sizeof(val)); }
-size_t OutStreamImpl::write(int64_t val)               { return write(&val,sizeof(val)); }
-size_t OutStreamImpl::write(uint8_t val)               { return write(&val,sizeof(val)); }
-size_t OutStreamImpl::write(uint16_t val)              { return write(&val,sizeof(val)); }
-size_t OutStreamImpl::write(uint32_t val)              { return write(&val,sizeof(val)); }
-size_t OutStreamImpl::write(uint64_t val)              { return write(&val,sizeof(val)); }
-size_t OutStreamImpl::write(float val)                 { return write(&val,sizeof(val)); }
-size_t OutStreamImpl::write(double val)                { return write(&val,sizeof(val)); }
-size_t OutStreamImpl::write(const api::UUID& val)      { return write(&val,sizeof(val)); }
-size_t OutStreamImpl::write(const api::ArrasTime& val) { return write(&val,sizeof(val)); }
-size_t OutStreamImpl::write(const api::Address& val)   { return write(&val,sizeof(val)); }
+size_t OutStreamImpl::write(bool val)                  { return writeValue(val); }
+size_t OutStreamImpl::write(int8_t val)                { return writeValue(val); }
+size_t OutStreamImpl::write(int16_t val)               { return writeValue(val); }
+size_t OutStreamImpl::write(int32_t val)               { return writeValue(val); }
+size_t OutStreamImpl::write(int64_t val)               { return writeValue(val); }
+size_t OutStreamImpl::write(uint8_t val)               { return writeValue(val); }
+size_t OutStreamImpl::write(uint16_t val)              { return writeValue(val); }
+size_t OutStreamImpl::write(uint32_t val)              { return writeValue(val); }
+size_t OutStreamImpl::write(uint64_t val)              { return writeValue(val); }
+size_t OutStreamImpl::write(float val)                 { return writeValue(val); }
+size_t OutStreamImpl::write(double val)                { return writeValue(val); }
+size_t OutStreamImpl::write(const api::UUID& val)      { return writeValue(val); }
+size_t OutStreamImpl::write(const api::ArrasTime& val) { return writeValue(val); }
+size_t OutStreamImpl::write(const api::Address& val)   { return writeValue(val); }
 #ifdef PLATFORM_APPLE
-    size_t OutStreamImpl::write(unsigned long val)         { return write(&val,sizeof(val)); }
+    size_t OutStreamImpl::write(unsigned long val)         { return writeValue(val); }
 #endif
+// strided arrays are copied element by element through the window,
+// contiguous ones as a single block (one memcpy per buffer segment)
+size_t InStreamImpl::readStrided(void* aBuf, size_t aElemSize,
+                                 size_t aCount, size_t aStride)
+{
+    if (aStride == aElemSize)
+        return read(aBuf, aElemSize * aCount);
+    unsigned char* p = static_cast<unsigned char*>(aBuf);
+    size_t bytesRead = 0;
+    for (size_t i = 0; i < aCount; i++, p += aStride)
+        bytesRead += read(p, aElemSize);
+    return bytesRead;
+}
+
+size_t OutStreamImpl::writeStrided(const void* aBuf, size_t aElemSize,
+                                   size_t aCount, size_t aStride)
+{
+    if (aStride == aElemSize)
+        return write(aBuf, aElemSize * aCount);
+    const unsigned char* p = static_cast<const unsigned char*>(aBuf);
+    size_t written = 0;
+    for (size_t i = 0; i < aCount; i++, p += aStride)
+        written += write(p, aElemSize);
+    return written;
+}
+
 namespace {
 
 // helper functions to read and write strings using a count field of type LengthType 
@@ -9,14 +9,36 @@
 #include <message_api/DataInStream.h>
 #include <message_api/DataOutStream.h>
 
+#include <cstring>
+
 namespace arras4
 {
     namespace impl {
 
-class InStreamImpl : public api::DataInStream
+// InStreamImpl and OutStreamImpl implement the stream interfaces on top
+// of a network DataSource/DataSink.
+//
+// If the source or sink supports direct access (readWindow/writeWindow),
+// the streams copy fixed size values straight to or from the window
+// using an inline cursor, and only call the source or sink when the window 
+// is exhausted (e.g. at the end of a MultiBuffer segment). Consumed or written 
+// data is committed by sync(), flush(), when the window runs out, and on
+// destruction. sync() must be called before anything else uses the 
+// underlying source or sink directly.
+class InStreamImpl final : public api::DataInStream
 {
 public:
     InStreamImpl(network::DataSource& source);
+    ~InStreamImpl();
+
+    InStreamImpl(const InStreamImpl&) = delete;
+    InStreamImpl& operator=(const InStreamImpl&) = delete;
+
+    // commit data read through the window to the source
+    void sync();
+    // forget the window without committing it : used when the 
+    // source has moved on (e.g. to a new frame) after an error
+    void discard();
 
     size_t read(void* aBuf, size_t aLen);
     size_t skip(size_t aLen); 
@@ -41,17 +63,42 @@ public:
 #ifdef PLATFORM_APPLE
     size_t read(unsigned long& val);
 #endif
+    size_t readStrided(void* aBuf, size_t aElemSize,
+                       size_t aCount, size_t aStride);
 
 
 protected:
+    template <typename T> size_t readValue(T& val) {
+        if (static_cast<size_t>(mWindowEnd - mCursor) >= sizeof(T)) {
+            std::memcpy(static_cast<void*>(&val), mCursor, sizeof(T));
+            mCursor += sizeof(T);
+            return sizeof(T);
+        }
+        return readSlow(reinterpret_cast<unsigned char*>(&val), sizeof(T));
+    }
+    size_t readSlow(unsigned char* aBuf, size_t aLen);
+
     network::DataSource& mSource;
 
+    // window onto the source data
+    const unsigned char* mWindowStart = nullptr;
+    const unsigned char* mCursor = nullptr;
+    const unsigned char* mWindowEnd = nullptr;
 };
 
-class OutStreamImpl : public api::DataOutStream
+class OutStreamImpl final : public api::DataOutStream
 {
 public:
     OutStreamImpl(network::DataSink& sink);
+    ~OutStreamImpl();
+
+    OutStreamImpl(const OutStreamImpl&) = delete;
+    OutStreamImpl& operator=(const OutStreamImpl&) = delete;
+
+    // commit data written through the window to the sink
+    void sync();
+    // forget the window without committing it
+    void discard();
 
     size_t write(const void* aBuf, size_t aLen);
     size_t fill(unsigned char aByte,size_t aCount);
@@ -77,10 +124,26 @@ public:
 #ifdef PLATFORM_APPLE
     size_t write(unsigned long val);
 #endif
+    size_t writeStrided(const void* aBuf, size_t aElemSize,
+                        size_t aCount, size_t aStride);
 
 protected:
+    template <typename T> size_t writeValue(const T& val) {
+        if (static_cast<size_t>(mWindowEnd - mCursor) >= sizeof(T)) {
+            std::memcpy(mCursor, &val, sizeof(T));
+            mCursor += sizeof(T);
+            return sizeof(T);
+        }
+        return writeSlow(reinterpret_cast<const unsigned char*>(&val), sizeof(T));
+    }
+    size_t writeSlow(const unsigned char* aBuf, size_t aLen);
+
     network::DataSink& mSink;
 
+    // window onto the sink's free space
+    unsigned char* mWindowStart = nullptr;
+    unsigned char* mCursor = nullptr;
+    unsigned char* mWindowEnd = nullptr;
 };
 
 }
@@ -17,19 +17,31 @@ namespace arras4 {
 namespace impl {
 
 Addresser::Addresser() :
-    mAddressing(new Addressing)
+    mAddressing(nullptr)
 {
+    mAddressings.emplace_back(new Addressing());
+    mAddressing.store(mAddressings.back().get(), std::memory_order_release);
 }
 
 void Addresser::update(const api::UUID& sourceCompId,
                      const ComputationMap& compMap,
                      api::ObjectConstRef aMessageFilters)
 {
-    Addressing* addressing = new Addressing(sourceCompId,
-					    compMap,
-					    aMessageFilters);
+    // build outside the lock : it is only needed to publish
+    std::unique_ptr<const Addressing> addressing(new Addressing(sourceCompId,
+                                                               compMap,
+                                                               aMessageFilters));
     std::lock_guard<std::mutex> lock(mUpdateMutex);
-    mAddressing.reset(addressing);
+    mAddressing.store(addressing.get(), std::memory_order_release);
+    mAddressings.emplace_back(std::move(addressing));
+}
+
+// the current addressing, which remains valid until the
+// Addresser is destroyed, even if there is an update
+const Addressing&
+Addresser::snapshot() const
+{
+    return *mAddressing.load(std::memory_order_acquire);
 }
 
 Addresser::~Addresser() 
@@ -39,17 +51,17 @@ Addresser::~Addresser()
 void 
 Addresser::address(Envelope& envelope) const
 {
-    std::lock_guard<std::mutex> lock(mUpdateMutex);
-    envelope.metadata()->from() = mAddressing->sourceAddress();
-    envelope.to() = mAddressing->addresses(envelope.metadata()->routingName());
+    const Addressing& addressing = snapshot();
+    envelope.metadata()->from() = addressing.sourceAddress();
+    envelope.setTo(addressing.addresses(envelope.metadata()->routingNameSymbol()));
 }
 
 void 
 Addresser::addressToAll(Envelope& envelope) const
 {
-    std::lock_guard<std::mutex> lock(mUpdateMutex);
-    envelope.metadata()->from() =  mAddressing->sourceAddress();
-    envelope.to() = mAddressing->allAddresses();
+    const Addressing& addressing = snapshot();
+    envelope.metadata()->from() = addressing.sourceAddress();
+    envelope.setTo(addressing.allAddresses());
 }
 
 // address to an explicit address or list of addresses
@@ -57,22 +69,22 @@ bool
 Addresser::addressTo(Envelope& envelope, 
                      api::ObjectConstRef addresses) const
 {
-    {
-        std::lock_guard<std::mutex> lock(mUpdateMutex);
-	envelope.metadata()->from() = mAddressing->sourceAddress();
-    }
+    const Addressing& addressing = snapshot();
+    envelope.metadata()->from() = addressing.sourceAddress();
+    api::AddressList to(envelope.to());
     api::Address addr;
     try {
         if (addresses.isArray()) {
             for (api::ObjectConstIterator it = addresses.begin();
                  it != addresses.end(); ++it) {
                 addr.fromObject(*it);
-                envelope.to().push_back(addr);
+                to.push_back(addr);
             }
         } else {
             addr.fromObject(addresses);
-            envelope.to().push_back(addr);
+            to.push_back(addr);
         }
+        envelope.setTo(to);
     } catch (std::exception&) { // our version of jsoncpp doesn't seem
         return false;           // to expose a specific exception
     }
@@ -9,10 +9,12 @@
 #include <message_api/Address.h>
 
 
+#include <atomic>
 #include <map>
 #include <memory>
-#include <string>
 #include <mutex>
+#include <string>
+#include <vector>
 
 /** Addresser fills in the 'to' addresses for a message coming from a 
  * particular computation. This task is performed either by the executor process 
@@ -34,6 +36,14 @@
  * Addressers are created with no initial addressing. The update() function
  * can be called at any time to set/reset the addressing based on a set
  * of message filters. update() is a threadsafe function.
+ *
+ * Routing updates are rare, but every outgoing message is addressed, so
+ * the current Addressing is published as an immutable snapshot, in the
+ * same way as the ContentRegistry table : update() builds a new Addressing
+ * and publishes it with an atomic pointer store, while addressing a message
+ * is just an atomic pointer load. Senders never take a lock. Replaced
+ * Addressings are kept until the Addresser is destroyed, since a sender
+ * may still be using one.
  **/
 namespace arras4 {
     namespace impl {
@@ -51,6 +61,9 @@ public:
 
     ~Addresser();
 
+    Addresser(const Addresser&) = delete;
+    Addresser& operator=(const Addresser&) = delete;
+
     // initialize/update the address using session routing data
     // aRoutingData is the data under the "routing"/"messageFilters" 
     // key, sent from coordinator to node.
@@ -71,9 +84,15 @@ public:
                    api::ObjectConstRef addresses) const;
 
 private:
-     
-    mutable std::mutex mUpdateMutex;
-    std::unique_ptr<Addressing> mAddressing;
+
+    const Addressing& snapshot() const;
+
+    // current addressing, read without locking
+    std::atomic<const Addressing*> mAddressing;
+
+    // serializes updates, and owns all addressings
+    std::mutex mUpdateMutex;
+    std::vector<std::unique_ptr<const Addressing>> mAddressings;
 };
 
 }
@@ -33,7 +33,9 @@ Addressing::Addressing(const api::UUID& sourceCompId,
     // which contains all computations that don't have an explicit "accept" list.
     //
 
-    compMap.getAllAddresses(mAllAddresses);
+    api::AddressList allAddresses;
+    compMap.getAllAddresses(allAddresses);
+    mAllAddresses = std::make_shared<const api::AddressList>(std::move(allAddresses));
 
     try {
 	mSourceAddress = compMap.getComputationAddress(sourceCompId);
@@ -46,8 +48,13 @@ Addressing::Addressing(const api::UUID& sourceCompId,
     const std::string sourceName(compMap.getComputationName(sourceCompId));
     api::ObjectConstRef filters = aMessageFilters[sourceName];
 
-    // process each filter, adding an entry to mMessageAddressMap for each
-    // routing name mentioned as a destination. mDefaultAddresses keeps
+    // the lists are built here, and then shared as immutable lists 
+    // once they are complete
+    std::unordered_map<std::string,api::AddressList> messageAddressMap;
+    api::AddressList defaultAddresses;
+
+    // process each filter, adding an entry to messageAddressMap for each
+    // routing name mentioned as a destination. defaultAddresses keeps
     // the addresses of the computations that should receive all unmapped 
     // messages. When a new message map entry is added, it is initialized from
     // this list.
@@ -68,8 +75,8 @@ Addressing::Addressing(const api::UUID& sourceCompId,
             for (api::ObjectConstIterator acceptIt = accepts.begin();
                  acceptIt != accepts.end(); ++acceptIt) {
                 if ((*acceptIt).isString()) {
-                        const std::string& msg = (*acceptIt).asString();
-                        auto inserted = mMessageAddressMap.insert(MessageAddressMap::value_type(msg,mDefaultAddresses));
+                        std::string msg = (*acceptIt).asString();
+                        auto inserted = messageAddressMap.insert(std::make_pair(msg,defaultAddresses));
                         inserted.first->second.push_back(destAddr);
                         foundAnAccept = true;
                 }
@@ -101,8 +108,8 @@ Addressing::Addressing(const api::UUID& sourceCompId,
         // add this destination to already mapped messages not in the ignore set. Erase entries
         // in ignoreSet as we go, so that we are left with just the unmapped messages that this 
         // computation ignores
-        for (auto it = mMessageAddressMap.begin();
-             it != mMessageAddressMap.end(); ++it) {
+        for (auto it = messageAddressMap.begin();
+             it != messageAddressMap.end(); ++it) {
             auto is_it = ignoreSet.find(it->first);
             if (is_it == ignoreSet.end()) {
                 it->second.push_back(destAddr);
@@ -117,30 +124,63 @@ Addressing::Addressing(const api::UUID& sourceCompId,
         // all default computations (because they don't go to this one)
         for (auto is_it = ignoreSet.begin(); 
              is_it != ignoreSet.end(); ++is_it) {
-            mMessageAddressMap.insert(MessageAddressMap::value_type(*is_it,mDefaultAddresses));
+            messageAddressMap.insert(std::make_pair(*is_it,defaultAddresses));
         }
 
         // everything in the ignore set has been processed, so this computation should
         // receive all remaining unlisted messages.
-        mDefaultAddresses.push_back(destAddr);
+        defaultAddresses.push_back(destAddr);
+    }
+
+    // names that share UNINTERNED_ROUTING_ID are kept by string
+    for (auto& entry : messageAddressMap) {
+        AddressListConstPtr list = 
+            std::make_shared<const api::AddressList>(std::move(entry.second));
+        RoutingName::ConstPtr name = RoutingName::intern(entry.first);
+        if (name->id() == UNINTERNED_ROUTING_ID)
+            mUninternedAddressMap.emplace(entry.first, list);
+        else
+            mMessageAddressMap.emplace(name->id(), list);
     }
+    mDefaultAddresses = std::make_shared<const api::AddressList>(std::move(defaultAddresses));
 }
 
 Addressing::~Addressing() 
 {
 }
 
-const api::AddressList&
-Addressing::addresses(const std::string& routingName) const
+const AddressListConstPtr&
+Addressing::addresses(const RoutingName& routingName) const
 {
-    auto it = mMessageAddressMap.find(routingName);
+    if (routingName.id() == UNINTERNED_ROUTING_ID)
+        return uninternedAddresses(routingName.str());
+    auto it = mMessageAddressMap.find(routingName.id());
     if (it == mMessageAddressMap.end()) 
         return mDefaultAddresses;
     else
         return it->second;
 }
 
-const api::AddressList&
+const AddressListConstPtr&
+Addressing::addresses(const std::string& routingName) const
+{
+    const RoutingName* name = RoutingName::find(routingName);
+    if (!name)
+        return uninternedAddresses(routingName);
+    return addresses(*name);
+}
+
+const AddressListConstPtr&
+Addressing::uninternedAddresses(const std::string& routingName) const
+{
+    auto it = mUninternedAddressMap.find(routingName);
+    if (it == mUninternedAddressMap.end()) 
+        return mDefaultAddresses;
+    else
+        return it->second;
+}
+
+const AddressListConstPtr&
 Addressing::allAddresses() const
 {
     return mAllAddresses;
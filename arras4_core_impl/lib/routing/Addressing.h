@@ -7,11 +7,12 @@
 #include <message_api/messageapi_types.h>
 #include <message_api/Object.h>
 #include <message_api/Address.h>
+#include <message_impl/Envelope.h>
+#include <message_impl/RoutingName.h>
 
-
-#include <map>
 #include <memory>
 #include <string>
+#include <unordered_map>
 
 /** Addressing stores a computation's message filters in an efficient format
  * that can be used by Addresser to address messages
@@ -30,13 +31,20 @@
  * all computations regardless of filters : this applies, for example, to
  * Ping messages
  *
+ * Routing names in the filters are interned (see RoutingName.h), and the
+ * message map is keyed by RoutingId, so addressing a message takes a
+ * single hash lookup on an integer. The empty name and any names that
+ * couldn't be interned share UNINTERNED_ROUTING_ID, so they are looked
+ * up by string instead. The destination lists are shared
+ * with the envelopes that are addressed with them, and are never modified
+ * after construction.
+ *
  * A mutex is not required, since the data is read-only after construction
  **/
 namespace arras4 {
     namespace impl {
         
 class ComputationMap;
-class Envelope;
             
 class Addressing {
 
@@ -56,24 +64,30 @@ public:
     const api::Address sourceAddress() const { return mSourceAddress; }
 
     // get list of addresses for a given message based on message filters
-    const api::AddressList& addresses(const std::string& routingName) const;
+    const AddressListConstPtr& addresses(const RoutingName& routingName) const;
+    const AddressListConstPtr& addresses(const std::string& routingName) const;
     // get all computation addresses except client
-    const api::AddressList& allAddresses() const;
+    const AddressListConstPtr& allAddresses() const;
 
 private:
+
+    const AddressListConstPtr& uninternedAddresses(const std::string& routingName) const;
             
     api::Address mSourceAddress;
 
     // map each routing name to the destination addresses it
     // should be sent to
-    typedef std::map<std::string,api::AddressList> MessageAddressMap;
+    typedef std::unordered_map<RoutingId,AddressListConstPtr> MessageAddressMap;
     MessageAddressMap mMessageAddressMap;
 
+    // entries for names with UNINTERNED_ROUTING_ID, which is usually empty
+    std::unordered_map<std::string,AddressListConstPtr> mUninternedAddressMap;
+
     // destinations for messages not listed in the message address map
-    api::AddressList mDefaultAddresses;
+    AddressListConstPtr mDefaultAddresses;
               
     // all destinations, excluding client
-    api::AddressList mAllAddresses;
+    AddressListConstPtr mAllAddresses;
 };
 
 }
@@ -81,10 +81,15 @@ void
 ComputationMap::getAllAddresses(api::AddressList& out,
                                 bool includeClient /* = false */) const
 {
+    api::AddressList addresses;
     for (const auto& entry : mCompIdToAddress) {
         if (includeClient || entry.first.valid())
-            out.push_back(entry.second);
+            addresses.push_back(entry.second);
     }
+    // keep the order independent of the hash table
+    addresses.sort([](const api::Address& a, const api::Address& b) {
+                       return a.computation < b.computation; });
+    out.splice(out.end(), addresses);
 }
     
 } 
@@ -8,9 +8,10 @@
 #include <message_api/Object.h>
 #include <message_api/Address.h>
 
+#include <cstring>
 #include <memory>
-#include <map>
 #include <string>
+#include <unordered_map>
 
 
 /** ComputationMap stores the mapping of computation names / ids to addresses for
@@ -28,6 +29,18 @@
  **/
 namespace arras4 {
     namespace impl {
+
+// hash for UUID keys : the bytes are already random, so the first
+// word of them is a good hash
+struct UUIDHash
+{
+    size_t operator()(const api::UUID& uuid) const
+    {
+        size_t h;
+        std::memcpy(&h, uuid.bytes().data(), sizeof(h));
+        return h;
+    }
+};
         
 class ComputationMap 
 {            
@@ -49,9 +62,9 @@ public:
     void getAllAddresses(api::AddressList& out, bool includeClient=false) const;
     
 private:            
-    std::map<std::string, api::UUID> mCompNameToId;
-    std::map<api::UUID, std::string> mCompIdToName;
-    std::map<api::UUID, api::Address> mCompIdToAddress;
+    std::unordered_map<std::string, api::UUID> mCompNameToId;
+    std::unordered_map<api::UUID, std::string, UUIDHash> mCompIdToName;
+    std::unordered_map<api::UUID, api::Address, UUIDHash> mCompIdToAddress;
 };
 
 }
@@ -0,0 +1,119 @@
+// Copyright 2023-2024 DreamWorks Animation LLC and Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "Histogram.h"
+
+#include <sstream>
+
+namespace {
+
+// values below LINEAR_LIMIT have a bucket each. Above that, each
+// power of 2 has SUB_BUCKETS buckets
+constexpr unsigned SUB_BITS = 3;
+constexpr uint64_t SUB_BUCKETS = 1 << SUB_BITS;
+constexpr unsigned LINEAR_BITS = SUB_BITS + 1;
+constexpr uint64_t LINEAR_LIMIT = 1 << LINEAR_BITS;
+
+unsigned highestBit(uint64_t value)
+{
+    unsigned bit = 0;
+    while (value >>= 1)
+        bit++;
+    return bit;
+}
+
+}
+
+namespace arras4 {
+    namespace impl {
+
+Histogram::Histogram()
+{
+    for (std::atomic<uint64_t>& count : mCounts)
+        count.store(0, std::memory_order_relaxed);
+    mSum.store(0, std::memory_order_relaxed);
+}
+
+size_t Histogram::bucketIndex(uint64_t value)
+{
+    if (value < LINEAR_LIMIT)
+        return value;
+    unsigned bit = highestBit(value);
+    size_t sub = (value >> (bit - SUB_BITS)) & (SUB_BUCKETS - 1);
+    size_t index = LINEAR_LIMIT + (bit - LINEAR_BITS) * SUB_BUCKETS + sub;
+    return index < BUCKETS ? index : BUCKETS - 1;
+}
+
+uint64_t Histogram::bucketUpperBound(size_t index)
+{
+    if (index < LINEAR_LIMIT)
+        return index;
+    unsigned bit = LINEAR_BITS + (index - LINEAR_LIMIT) / SUB_BUCKETS;
+    uint64_t sub = (index - LINEAR_LIMIT) % SUB_BUCKETS;
+    uint64_t width = uint64_t(1) << (bit - SUB_BITS);
+    return (SUB_BUCKETS + sub) * width + width - 1;
+}
+
+HistogramSnapshot Histogram::snapshot() const
+{
+    HistogramSnapshot s;
+    for (size_t i = 0; i < BUCKETS; i++)
+        s.mCounts[i] = mCounts[i].load(std::memory_order_relaxed);
+    s.mSum = mSum.load(std::memory_order_relaxed);
+    return s;
+}
+
+uint64_t HistogramSnapshot::count() const
+{
+    uint64_t total = 0;
+    for (uint64_t c : mCounts)
+        total += c;
+    return total;
+}
+
+double HistogramSnapshot::mean() const
+{
+    uint64_t n = count();
+    return n ? double(mSum) / double(n) : 0.0;
+}
+
+uint64_t HistogramSnapshot::percentile(double percent) const
+{
+    uint64_t n = count();
+    if (n == 0)
+        return 0;
+    // rank of the value we want, counting from 1
+    uint64_t rank = uint64_t(percent * double(n) / 100.0 + 0.5);
+    if (rank < 1) rank = 1;
+    if (rank > n) rank = n;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < mCounts.size(); i++) {
+        seen += mCounts[i];
+        if (seen >= rank)
+            return Histogram::bucketUpperBound(i);
+    }
+    return Histogram::bucketUpperBound(mCounts.size() - 1);
+}
+
+void HistogramSnapshot::subtract(const HistogramSnapshot& earlier)
+{
+    for (size_t i = 0; i < mCounts.size(); i++) {
+        mCounts[i] = mCounts[i] >= earlier.mCounts[i] ?
+            mCounts[i] - earlier.mCounts[i] : 0;
+    }
+    mSum = mSum >= earlier.mSum ? mSum - earlier.mSum : 0;
+}
+
+std::string HistogramSnapshot::describe() const
+{
+    std::stringstream ss;
+    ss.precision(1);
+    ss << std::fixed;
+    ss << "n=" << count() << " mean=" << mean()
+       << " p50=" << percentile(50) << " p90=" << percentile(90)
+       << " p99=" << percentile(99) << " max=" << max();
+    return ss.str();
+}
+
+}
+}
@@ -0,0 +1,85 @@
+// Copyright 2023-2024 DreamWorks Animation LLC and Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __ARRAS4_HISTOGRAMH__
+#define __ARRAS4_HISTOGRAMH__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace arras4 {
+    namespace impl {
+
+class HistogramSnapshot;
+
+// Histogram of non-negative integer values (e.g. latencies in
+// microseconds, or queue depths), with the same log-linear bucketing
+// as an HDR histogram : values below 16 are counted exactly, and
+// above that each power of 2 is split into 8 buckets, so a value is
+// known to within 12.5%. Values above 2^44 go in the top bucket.
+//
+// record() is lock-free (a relaxed atomic increment), and so may be
+// called from any thread without disturbing the recording thread's
+// timing. Reading is done by taking a snapshot : counts recorded
+// while the snapshot is being taken may or may not be included.
+class Histogram
+{
+public:
+    static constexpr size_t BUCKETS = 16 + 41*8;
+
+    Histogram();
+    Histogram(const Histogram&) = delete;
+    Histogram& operator=(const Histogram&) = delete;
+
+    void record(uint64_t value)
+    {
+        mCounts[bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+        mSum.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    HistogramSnapshot snapshot() const;
+
+    static size_t bucketIndex(uint64_t value);
+    // highest value that goes in bucket 'index'
+    static uint64_t bucketUpperBound(size_t index);
+
+private:
+    std::atomic<uint64_t> mCounts[BUCKETS];
+    std::atomic<uint64_t> mSum;
+};
+
+// Copy of the counts in a Histogram at some point in time. Subtracting
+// an earlier snapshot of the same histogram gives the values recorded
+// in between.
+class HistogramSnapshot
+{
+public:
+    HistogramSnapshot() : mCounts(Histogram::BUCKETS, 0) {}
+
+    uint64_t count() const;
+    uint64_t sum() const { return mSum; }
+    double mean() const;
+
+    // smallest bucket bound that at least 'percent' % of the values are
+    // less than or equal to. Returns 0 if the snapshot is empty
+    uint64_t percentile(double percent) const;
+    uint64_t max() const { return percentile(100.0); }
+
+    // remove the values in 'earlier'
+    void subtract(const HistogramSnapshot& earlier);
+
+    // e.g. "n=120 mean=31.5 p50=27 p90=45 p99=104 max=239"
+    std::string describe() const;
+
+private:
+    friend class Histogram;
+    std::vector<uint64_t> mCounts;
+    uint64_t mSum = 0;
+};
+
+}
+}
+#endif
@@ -0,0 +1,122 @@
+// Copyright 2023-2024 DreamWorks Animation LLC and Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __ARRAS4_LOCKFREE_RINGH__
+#define __ARRAS4_LOCKFREE_RINGH__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace arras4 {
+    namespace impl {
+
+// Bounded lock-free queue, used by ThreadsafeQueue in QueueMode::LockFree.
+//
+// This is the well known sequence-numbered ring (after D. Vyukov) : each
+// cell carries a sequence number that tells producers and consumers
+// whether it is free or full for the current lap of the ring, so pushing
+// and popping only need a compare-and-swap on the tail or head index. Any
+// number of threads may push and pop concurrently.
+//
+// tryPush() and tryPop() never block : waiting when the ring is full
+// or empty is left to the caller. Elements are moved in and out, and a
+// popped cell is reset to T() so that it doesn't hold on to resources.
+template<typename T>
+class LockFreeRing
+{
+public:
+    // capacity is rounded up to a power of 2
+    explicit LockFreeRing(size_t capacity)
+    {
+        size_t size = 2;
+        while (size < capacity)
+            size <<= 1;
+        mMask = size - 1;
+        mCells.reset(new Cell[size]);
+        for (size_t i = 0; i < size; i++)
+            mCells[i].mSeq.store(i, std::memory_order_relaxed);
+    }
+
+    LockFreeRing(const LockFreeRing&) = delete;
+    LockFreeRing& operator=(const LockFreeRing&) = delete;
+
+    // moves 't' into the ring and returns true, or returns false
+    // (leaving 't' unchanged) if the ring is full
+    bool tryPush(T& t)
+    {
+        Cell* cell;
+        size_t pos = mTail.load(std::memory_order_relaxed);
+        while (true) {
+            cell = &mCells[pos & mMask];
+            size_t seq = cell->mSeq.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (mTail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            } else if (diff < 0) {
+                return false; // full
+            } else {
+                pos = mTail.load(std::memory_order_relaxed);
+            }
+        }
+        cell->mValue = std::move(t);
+        cell->mSeq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // moves the oldest element into 't' and returns true, or returns
+    // false if the ring is empty
+    bool tryPop(T& t)
+    {
+        Cell* cell;
+        size_t pos = mHead.load(std::memory_order_relaxed);
+        while (true) {
+            cell = &mCells[pos & mMask];
+            size_t seq = cell->mSeq.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (mHead.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            } else if (diff < 0) {
+                return false; // empty
+            } else {
+                pos = mHead.load(std::memory_order_relaxed);
+            }
+        }
+        t = std::move(cell->mValue);
+        cell->mValue = T();
+        cell->mSeq.store(pos + mMask + 1, std::memory_order_release);
+        return true;
+    }
+
+    // approximate, since other threads may be pushing or popping
+    size_t size() const
+    {
+        size_t head = mHead.load(std::memory_order_acquire);
+        size_t tail = mTail.load(std::memory_order_acquire);
+        return tail > head ? tail - head : 0;
+    }
+    bool empty() const { return size() == 0; }
+    bool full() const { return size() > mMask; }
+    size_t capacity() const { return mMask + 1; }
+
+private:
+    struct Cell {
+        std::atomic<size_t> mSeq;
+        T mValue;
+    };
+
+    std::unique_ptr<Cell[]> mCells;
+    size_t mMask;
+
+    // producers and consumers are on different cache lines
+    alignas(64) std::atomic<size_t> mTail{0};
+    alignas(64) std::atomic<size_t> mHead{0};
+};
+
+}
+}
+#endif
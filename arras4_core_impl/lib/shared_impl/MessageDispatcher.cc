@@ -4,7 +4,11 @@
 #include "MessageDispatcher.h"
 #include "DispatcherExitReason.h"
 
+#include <core_messages/ControlMessage.h>
 #include <core_messages/ExecutorHeartbeat.h>
+#include <core_messages/PingMessage.h>
+#include <core_messages/PongMessage.h>
+#include <exceptions/QueueFullException.h>
 #include <exceptions/ShutdownException.h>
 #include <message_api/Message.h>
 #include <network/PeerException.h>
@@ -15,26 +19,204 @@
 #include <arras4_log/Logger.h>
 #include <arras4_log/LogEventStream.h>
 
+#include <algorithm>
+#include <sstream>
+
 using namespace arras4::network;
 
+namespace {
+
+// control and liveness messages use the High priority lane
+arras4::impl::QueuePriority messagePriority(const arras4::impl::Envelope& envelope)
+{
+    using namespace arras4::impl;
+    const arras4::api::ClassID& id = envelope.classId();
+    if (id == ControlMessage::ID ||
+        id == ExecutorHeartbeat::ID ||
+        id == PingMessage::ID ||
+        id == PongMessage::ID)
+        return QueuePriority::High;
+    return QueuePriority::Normal;
+}
+
+// maximum number of messages taken from a queue at once
+// by the handler and outgoing threads
+constexpr size_t DISPATCH_BATCH_SIZE = 64;
+
+// messages waiting for each handler pool thread. When it is full, the
+// handler thread blocks, so backpressure reaches the incoming queue
+constexpr size_t POOL_QUEUE_LIMIT = 256;
+
+// FNV-1a
+size_t hashBytes(const unsigned char* data, size_t len, size_t h = 14695981039346656037ull)
+{
+    for (size_t i = 0; i < len; i++) {
+        h ^= data[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+size_t orderingKey(const arras4::impl::Envelope& envelope,
+                   arras4::impl::HandlerOrdering ordering)
+{
+    using arras4::impl::HandlerOrdering;
+    const arras4::impl::MetadataImpl::Ptr& md = envelope.metadata();
+    if (!md)
+        return 0;
+    switch (ordering) {
+    case HandlerOrdering::SourceId:
+        return hashBytes(md->sourceId().bytes().data(), 16);
+    case HandlerOrdering::RoutingName:
+        // interned names carry their hash
+        return md->routingNameSymbol().hash();
+    default:
+        return hashBytes(md->from().computation.bytes().data(), 16,
+                         hashBytes(md->from().node.bytes().data(), 16));
+    }
+}
+
+}
+
 namespace arras4 {
     namespace impl {
 
 std::chrono::microseconds MessageDispatcher::NO_IDLE(0);
 
+std::string dispatchStageAsString(DispatchStage stage)
+{
+    switch (stage) {
+    case DispatchStage::Incoming: return "incoming";
+    case DispatchStage::Handler:  return "handler";
+    case DispatchStage::Outgoing: return "outgoing";
+    }
+    return "unknown";
+}
+
 MessageDispatcher::~MessageDispatcher() 
 {
     postQuit();
     waitForExit();
 }
 
+void MessageDispatcher::setQueueMode(QueueMode mode, size_t capacity)
+{
+    std::unique_lock<std::mutex> lock(mStateMutex);
+    if (mState != DispatcherState::NotStarted)
+        throw std::logic_error("MessageDispatcher [" + mLabel + "] : called setQueueMode after dispatcher has started");
+    mIncomingQueue.setMode(mode, capacity);
+    mOutgoingQueue.setMode(mode, capacity);
+}
+
+void MessageDispatcher::setQueueLimits(const QueueLimits& incoming,
+                                       const QueueLimits& outgoing)
+{
+    std::unique_lock<std::mutex> lock(mStateMutex);
+    if (mState != DispatcherState::NotStarted)
+        throw std::logic_error("MessageDispatcher [" + mLabel + "] : called setQueueLimits after dispatcher has started");
+    // the reader thread must keep reading, to receive control messages
+    if (incoming.isLimited() && incoming.policy == OverflowPolicy::Block)
+        throw std::logic_error("MessageDispatcher [" + mLabel + "] : the incoming queue cannot use overflow policy 'block'");
+    MessageQueue::SizeFunction sizeOf = [](const Envelope& env) { return env.byteSize(); };
+    mIncomingQueue.setLimits(incoming, sizeOf,
+                             [this,incoming](bool full) { onWatermark("incoming",incoming,full); });
+    mOutgoingQueue.setLimits(outgoing, sizeOf,
+                             [this,outgoing](bool full) { onWatermark("outgoing",outgoing,full); });
+}
+
+// called by a bounded queue when it becomes full or drains
+void MessageDispatcher::onWatermark(const std::string& queueName,
+                                    const QueueLimits& limits,
+                                    bool full)
+{
+    if (full) {
+        ARRAS_WARN(log::Id("dispatchQueueFull") <<
+                   "MessageDispatcher [" << mLabel << "] : " << queueName <<
+                   " queue is full, applying overflow policy '" <<
+                   overflowPolicyAsString(limits.policy) << "'");
+    } else {
+        ARRAS_INFO(log::Id("dispatchQueueDrained") <<
+                   "MessageDispatcher [" << mLabel << "] : " << queueName <<
+                   " queue has drained. " << droppedMessageCount() << 
+                   " messages dropped or rejected so far");
+    }
+}
+
+unsigned long MessageDispatcher::droppedMessageCount() const
+{
+    return mIncomingQueue.droppedCount() + mIncomingQueue.rejectedCount() +
+        mOutgoingQueue.droppedCount() + mOutgoingQueue.rejectedCount();
+}
+
+void MessageDispatcher::setIdleInterval(const std::chrono::microseconds& interval,
+                                        const std::chrono::microseconds& maxInterval)
+{
+    std::unique_lock<std::mutex> lock(mStateMutex);
+    if (mState != DispatcherState::NotStarted &&
+        mState != DispatcherState::Queueing)
+        throw std::logic_error("MessageDispatcher [" + mLabel + "] : called setIdleInterval after dispatching has started");
+    mIdleInterval = interval;
+    mMaxIdleInterval = std::max(interval, maxInterval);
+}
+
+void MessageDispatcher::setHandlerPool(unsigned threads, HandlerOrdering ordering)
+{
+    std::unique_lock<std::mutex> lock(mStateMutex);
+    if (mState != DispatcherState::NotStarted &&
+        mState != DispatcherState::Queueing)
+        throw std::logic_error("MessageDispatcher [" + mLabel + "] : called setHandlerPool after dispatching has started");
+    mPool.clear();
+    mOrdering = ordering;
+    if (threads <= 1)
+        return;
+    QueueLimits limits;
+    limits.maxItems = POOL_QUEUE_LIMIT;
+    for (unsigned i = 0; i < threads; i++) {
+        mPool.emplace_back(new PoolWorker(mLabel + ":handler" + std::to_string(i)));
+        mPool.back()->queue.setLimits(limits);
+    }
+}
+
 bool MessageDispatcher::send(const Envelope& envelope)
+{
+    return queueOutgoing([&]() {
+            Envelope queued(envelope);
+            queued.stampQueued();
+            QueuePriority priority = messagePriority(queued);
+            mOutgoingQueue.push(std::move(queued),priority);
+        });
+}
+
+bool MessageDispatcher::send(std::vector<Envelope>& envelopes)
+{
+    return queueOutgoing([&]() {
+            // control messages go straight to the High priority lane,
+            // the rest are pushed together
+            std::vector<Envelope> normal;
+            normal.reserve(envelopes.size());
+            for (Envelope& envelope : envelopes) {
+                envelope.stampQueued();
+                if (messagePriority(envelope) == QueuePriority::High)
+                    mOutgoingQueue.push(std::move(envelope),QueuePriority::High);
+                else
+                    normal.push_back(std::move(envelope));
+            }
+            envelopes.clear();
+            mOutgoingQueue.pushBatch(normal);
+        });
+}
+
+// run a push onto the outgoing queue, returning false if it fails
+bool MessageDispatcher::queueOutgoing(const std::function<void()>& pushFn)
 {
     bool ok = true;
     try {
-        mOutgoingQueue.push(envelope);
+        pushFn();
     } catch (ShutdownException&) {
         ok = false;
+    } catch (QueueFullException&) {
+        // rejected by a bounded queue : logged by onWatermark
+        ok = false;
     }  catch (std::exception& e) {
         ARRAS_ERROR(log::Id("exceptionSending") <<
                     "MessageDispatcher [" << mLabel << "] : exception while sending message : " << e.what());
@@ -54,9 +236,13 @@ void MessageDispatcher::incomingThreadProc()
         try {
             Envelope envelope = mSource->getEnvelope(); 
                        // mSource is valid while thread is running..
-            mIncomingQueue.push(envelope);
+            QueuePriority priority = messagePriority(envelope);
+            envelope.stampQueued();
+            mIncomingQueue.push(std::move(envelope),priority);
         } catch (ShutdownException&) {
             // queue has been unblocked to give us a chance to exit
+        } catch (QueueFullException&) {
+            // bounded queue rejected the message : it is discarded
         } catch (network::PeerDisconnectException&) {
             postError(DispatcherExitReason::Disconnected);
         } catch (std::exception& e) {
@@ -70,16 +256,22 @@ void MessageDispatcher::incomingThreadProc()
 void MessageDispatcher::outgoingThreadProc()
 {
     log::Logger::instance().setThreadName("outgoing");
+    std::vector<Envelope> batch;
     while (mState != DispatcherState::Exiting) {
         try {
-            Envelope envelope;
-            mOutgoingQueue.pop(envelope);
-            mSource->putEnvelope(envelope);   
-                      // mSource is valid while thread is running...
-            // Don't count heartbeat in the message count
-            if (envelope.classId() != ExecutorHeartbeat::CLASS_ID()) {
-                mSentCount++;
+            // messages taken together from the queue are written as a
+            // batch, so that small ones can share a socket write
+            size_t popped = mOutgoingQueue.popBatch(batch,DISPATCH_BATCH_SIZE);
+            recordDepth(DispatchStage::Outgoing,popped + mOutgoingQueue.size());
+            mSource->beginBatch();
+            for (const Envelope& envelope : batch) {
+                // the batch holds High priority messages first : any
+                // that have arrived since go ahead of the Normal ones
+                if (messagePriority(envelope) == QueuePriority::Normal)
+                    sendHighPriority();
+                putOutgoing(envelope);
             }
+            mSource->endBatch();
         } catch (ShutdownException&) {
             // queue has been unblocked to give us a chance to exit
         } catch (network::PeerDisconnectException&) {
@@ -92,21 +284,129 @@ void MessageDispatcher::outgoingThreadProc()
     }
 }
 
+// send a message on the endpoint : only called by the outgoing thread
+void MessageDispatcher::putOutgoing(const Envelope& envelope)
+{
+    mSource->putEnvelope(envelope);
+              // mSource is valid while thread is running...
+    recordLatency(DispatchStage::Outgoing,envelope.queuedTime(),
+                  Envelope::Clock::now());
+    // Don't count heartbeat in the message count
+    if (envelope.classId() != ExecutorHeartbeat::CLASS_ID()) {
+        mSentCount++;
+    }
+}
+
+void MessageDispatcher::handleEnvelope(Envelope& envelope)
+{
+    mReceivedCount++;
+    Envelope::Clock::time_point start = Envelope::Clock::now();
+    recordLatency(DispatchStage::Incoming,envelope.queuedTime(),start);
+    mHandler.handleMessage(envelope.makeMessage());
+    recordLatency(DispatchStage::Handler,start,Envelope::Clock::now());
+}
+
+void MessageDispatcher::recordLatency(DispatchStage stage,
+                                      const std::chrono::steady_clock::time_point& start,
+                                      const std::chrono::steady_clock::time_point& end)
+{
+    // messages that didn't come through send() aren't stamped
+    if (start.time_since_epoch().count() == 0)
+        return;
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    mLatency[static_cast<size_t>(stage)].record(us > 0 ? us : 0);
+}
+
+std::string MessageDispatcher::describeMetrics() const
+{
+    std::stringstream ss;
+    for (size_t i = 0; i < DISPATCH_STAGE_COUNT; i++) {
+        DispatchStage stage = static_cast<DispatchStage>(i);
+        if (i > 0) ss << "\n";
+        ss << dispatchStageAsString(stage) << " latency(us) [" 
+           << mLatency[i].snapshot().describe() << "] depth ["
+           << mDepth[i].snapshot().describe() << "]";
+    }
+    return ss.str();
+}
+
+// handle the message on this thread, or pass it to the pool
+void MessageDispatcher::routeEnvelope(Envelope& envelope)
+{
+    if (mPool.empty()) {
+        handleEnvelope(envelope);
+        return;
+    }
+    size_t index = orderingKey(envelope,mOrdering) % mPool.size();
+    QueuePriority priority = messagePriority(envelope);
+    mPool[index]->queue.push(std::move(envelope),priority);
+}
+
+void MessageDispatcher::workerThreadProc(PoolWorker& worker)
+{
+    log::Logger::instance().setThreadName("handler");
+    std::vector<Envelope> batch;
+    while (mState != DispatcherState::Exiting) {
+        try {
+            size_t popped = worker.queue.popBatch(batch,DISPATCH_BATCH_SIZE);
+            recordDepth(DispatchStage::Handler,popped + worker.queue.size());
+            for (Envelope& envelope : batch) {
+                handleEnvelope(envelope);
+                if (mState == DispatcherState::Exiting)
+                    break;
+            }
+        } catch (ShutdownException&) {
+            // queue has been unblocked to give us a chance to exit
+        } catch (std::exception& e) {
+            postError(DispatcherExitReason::HandlerError,e.what());
+        } catch (...) {
+            postError(DispatcherExitReason::HandlerError);
+        }
+    }
+}
+
+// called by the endpoint between the frames of a large message,
+// to send any pending High priority messages
+void MessageDispatcher::sendHighPriority()
+{
+    Envelope envelope;
+    while (mOutgoingQueue.tryPopHigh(envelope))
+        putOutgoing(envelope);
+}
+
 void MessageDispatcher::handlerThreadProc()
 {
     log::Logger::instance().setThreadName("handler");
+    std::vector<Envelope> batch;
+    std::chrono::microseconds idleInterval = mIdleInterval;
     while (mState != DispatcherState::Exiting) { 
-        Envelope envelope;
         try {     
             // handler thread calls onIdle if it waits too long
-            // for a message to be ready.
-            bool popped = mIncomingQueue.pop(envelope,mIdleInterval);
-            if (popped) {
-                mReceivedCount++;
-                mHandler.handleMessage(envelope.makeMessage());
+            // for a message to be ready. The wait doubles while
+            // onIdle has nothing to do
+            size_t popped = mIncomingQueue.popBatch(batch,DISPATCH_BATCH_SIZE,idleInterval);
+            if (popped == 0) {
+                if (mHandler.onIdle())
+                    idleInterval = mIdleInterval;
+                else
+                    idleInterval = std::min(idleInterval * 2, mMaxIdleInterval);
+                continue;
+            }
+            idleInterval = mIdleInterval;
+            recordDepth(DispatchStage::Incoming,popped + mIncomingQueue.size());
+            for (Envelope& envelope : batch) {
+                // the batch holds High priority messages first : any
+                // that arrive while it is being handled go ahead of
+                // the Normal ones
+                if (messagePriority(envelope) == QueuePriority::Normal) {
+                    Envelope urgent;
+                    while (mIncomingQueue.tryPopHigh(urgent))
+                        routeEnvelope(urgent);
+                }
+                routeEnvelope(envelope);
+                if (mState == DispatcherState::Exiting)
+                    break;
             }
-            else
-                mHandler.onIdle();
         } catch (ShutdownException&) {
             // queue has been unblocked to give us a chance to exit
         } catch (std::exception& e) {
@@ -136,6 +436,11 @@ void MessageDispatcher::masterThreadProc()
         outgoing = std::thread(&MessageDispatcher::outgoingThreadProc, this);
         handler = std::thread(&MessageDispatcher::handlerThreadProc,this);
         mLimits.apply(handler);
+        for (std::unique_ptr<PoolWorker>& worker : mPool) {
+            worker->thread = std::thread(&MessageDispatcher::workerThreadProc,this,
+                                         std::ref(*worker));
+            mLimits.apply(worker->thread);
+        }
 
         // wait for the signal to exit
         while (mState != DispatcherState::Exiting)
@@ -145,6 +450,8 @@ void MessageDispatcher::masterThreadProc()
     // make sure all the threads are unblocked
     mIncomingQueue.shutdown();
     mOutgoingQueue.shutdown();
+    for (std::unique_ptr<PoolWorker>& worker : mPool)
+        worker->queue.shutdown();
     mSource->shutdown();
 
     // wait for the threads to exit
@@ -154,9 +461,19 @@ void MessageDispatcher::masterThreadProc()
     if (incoming.joinable()) incoming.join();
     if (outgoing.joinable()) outgoing.join();
     if (handler.joinable()) handler.join();
+    for (std::unique_ptr<PoolWorker>& worker : mPool) {
+        if (worker->thread.joinable()) worker->thread.join();
+    }
 
+    mSource->setFrameGapCallback(MessageEndpoint::FrameGapCallback());
     mSource.reset();
 
+    if (mReceivedCount || mSentCount) {
+        ARRAS_INFO(log::Id("dispatcherMetrics") <<
+                   "MessageDispatcher [" << mLabel << "] : queue metrics\n" <<
+                   describeMetrics());
+    }
+
     if (mObserver) mObserver->onDispatcherExit(mExitReason);
 
     lock.lock();
@@ -173,6 +490,7 @@ void MessageDispatcher::startQueueing(const std::shared_ptr<MessageEndpoint>& aS
         throw std::logic_error("MessageDispatcher [" + mLabel + "] : called startQueueing after dispatcher has started");
         
     mSource = aSource;
+    mSource->setFrameGapCallback([this]() { sendHighPriority(); });
     mState = DispatcherState::Queueing;
     mMasterThread = std::thread(&MessageDispatcher::masterThreadProc, this);
 }
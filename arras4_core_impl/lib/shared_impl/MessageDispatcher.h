@@ -8,6 +8,7 @@
 #include "MessageHandler.h"
 #include "ExecutionLimits.h"
 #include "DispatcherExitReason.h"
+#include "Histogram.h"
 
 #include <network/network_types.h>
 #include <message_api/messageapi_types.h>
@@ -17,7 +18,9 @@
 #include <exception>
 #include <atomic>
 #include <chrono>
+#include <functional>
 #include <mutex>
+#include <vector>
 
 
 namespace arras4 {
@@ -53,11 +56,61 @@ namespace arras4 {
 // longer than this time in onIdle will not displace message handling. 
 // Passing in zero (or NO_IDLE) for 'idleInterval' prevents idle callback altogether.
 //
-// Note: The dispatch queues are unbounded, which means if the send rate
+// The interval backs off while the handler's onIdle() returns false (i.e.
+// it had nothing to do), doubling on each call up to the maximum set by
+// setIdleInterval(). It returns to 'idleInterval' as soon as onIdle()
+// returns true or a message arrives. A message arriving always wakes the
+// handler thread immediately, whatever the interval.
+//
+// By default the dispatch queues are unbounded, which means if the send rate
 // is too high, or handle rate is too low, over a sustained period, then
 // transmission delay will grow indefinitely, together with the queue size.
-// There is an open task to allow these queues to be bounded by some measure
-// (count or total queued message size...)
+// setQueueLimits() bounds them by message count and/or total message size,
+// with a policy for what happens on overflow (see QueueLimits.h). A 
+// blocking outgoing queue holds up the threads calling send(). The incoming
+// queue can't block : the reader thread would stop reading the socket, and
+// so would not see control and liveness messages either, just when the
+// computation is overloaded. It drops or rejects instead.
+//
+// Control and liveness messages (ControlMessage, ExecutorHeartbeat,
+// PingMessage and PongMessage) go in the High priority lane of both queues
+// (see ThreadsafeQueue.h), so they are not held up behind data messages or
+// by queue limits. If the endpoint sends large messages as several frames
+// (i.e. chunking), pending High priority messages are also sent between
+// the frames.
+//
+// Normally onMessage() is called on the single handler thread, so it
+// is strictly serial. setHandlerPool() instead runs onMessage() on a pool
+// of threads, for computations that can handle independent streams of
+// messages concurrently. Messages are assigned to a pool thread by a key
+// taken from their metadata (see HandlerOrdering), so that messages with
+// the same key are still handled one at a time, in the order they
+// arrived. The handler thread then only distributes messages to the pool,
+// and calls onIdle(), which may therefore run concurrently with
+// onMessage().
+//
+// The dispatcher keeps histograms of latency and queue depth for each
+// DispatchStage, so that a slow message can be put down to the network,
+// queueing or the computation itself. Messages are stamped when they are
+// queued, and the latencies are in microseconds. Queue depth is sampled
+// each time a thread takes messages from its queue : there is no handler
+// stage queue unless setHandlerPool() is used.
+
+// selects the key used to assign messages to handler pool threads
+enum class HandlerOrdering {
+    Sender,      // computation that sent the message : metadata from()
+    SourceId,    // metadata sourceId(), which is set by the application
+    RoutingName  // metadata routingName(), i.e. the message type
+};
+
+// stages that a message passes through in the dispatcher
+enum class DispatchStage {
+    Incoming, // latency : received until onMessage() is called
+    Handler,  // latency : time spent in onMessage()
+    Outgoing  // latency : send() until written to the endpoint
+};
+constexpr size_t DISPATCH_STAGE_COUNT = 3;
+std::string dispatchStageAsString(DispatchStage stage);
 
 class DispatcherObserver 
 {
@@ -79,6 +132,7 @@ public:
         : mLabel(label),
           mHandler(aHandler),
           mIdleInterval(idleInterval),
+          mMaxIdleInterval(idleInterval),
           mObserver(observer),
           mOutgoingQueue(label+":outgoing"),
           mIncomingQueue(label+":incoming"),
@@ -89,11 +143,41 @@ public:
 
     ~MessageDispatcher();
 
+    // select the implementation of the incoming and outgoing queues
+    // (see ThreadsafeQueue.h). Must be called before startQueueing()
+    void setQueueMode(QueueMode mode,
+                      size_t capacity=DEFAULT_LOCKFREE_QUEUE_CAPACITY);
+
+    // bound the incoming and outgoing queues. Must be called before
+    // startQueueing(), and requires QueueMode::Locked. With
+    // OverflowPolicy::Reject a full outgoing queue makes send() return
+    // false, and a full incoming queue discards received messages.
+    // Throws std::logic_error if the incoming queue is limited with
+    // OverflowPolicy::Block
+    void setQueueLimits(const QueueLimits& incoming,
+                        const QueueLimits& outgoing);
+
+    // change the idle interval, and set the limit for idle backoff.
+    // 'maxInterval' equal to 'interval' disables backoff. Must be called
+    // before startDispatching()
+    void setIdleInterval(const std::chrono::microseconds& interval,
+                         const std::chrono::microseconds& maxInterval);
+
+    // Handle incoming messages on 'threads' pool threads (see above).
+    // 'threads' <= 1 gives the default single handler thread. Must be
+    // called before startDispatching()
+    void setHandlerPool(unsigned threads,
+                        HandlerOrdering ordering=HandlerOrdering::Sender);
+
     // Place a message on the outgoing queue. Can be called any time after 
     // construction. It will be sent as soon as possible, once startDispatching() 
     // has called.
     bool send(const Envelope& message);
 
+    // Place several messages on the outgoing queue, taking the queue
+    // lock once. The envelopes are moved out of 'messages'
+    bool send(std::vector<Envelope>& messages);
+
     // startQueuing() begins running the reader thread, so that incoming
     // messages are captured but not handled yet. The MessageEndpoint*
     // passed in as 'aSource' must remain valid until waitForExit() terminates,
@@ -124,11 +208,37 @@ public:
     unsigned long sentMessageCount() const { return mSentCount; }
     unsigned long receivedMessageCount() const { return mReceivedCount; }
 
+    // return counts of messages discarded by the DropOldest and Reject
+    // overflow policies. May be called from any thread.
+    unsigned long droppedMessageCount() const;
+
+    // latency and queue depth histograms (see above). May be called
+    // from any thread
+    const Histogram& latencyHistogram(DispatchStage stage) const
+        { return mLatency[static_cast<size_t>(stage)]; }
+    const Histogram& depthHistogram(DispatchStage stage) const
+        { return mDepth[static_cast<size_t>(stage)]; }
+
+    // summary of the histograms, one line per stage
+    std::string describeMetrics() const;
+
 private:
     void incomingThreadProc();
     void outgoingThreadProc();
     void handlerThreadProc();
     void masterThreadProc();
+    bool queueOutgoing(const std::function<void()>& pushFn);
+    void putOutgoing(const Envelope& envelope);
+    void handleEnvelope(Envelope& envelope);
+    void routeEnvelope(Envelope& envelope);
+    void sendHighPriority();
+    void recordLatency(DispatchStage stage,
+                       const std::chrono::steady_clock::time_point& start,
+                       const std::chrono::steady_clock::time_point& end);
+    void recordDepth(DispatchStage stage, size_t depth)
+        { mDepth[static_cast<size_t>(stage)].record(depth); }
+    void onWatermark(const std::string& queueName, 
+                     const QueueLimits& limits, bool full);
 
     std::string mLabel;
     std::shared_ptr<MessageEndpoint> mSource; 
@@ -136,6 +246,7 @@ private:
 
     MessageHandler& mHandler;
     std::chrono::microseconds mIdleInterval;
+    std::chrono::microseconds mMaxIdleInterval;
     DispatcherObserver* mObserver;
 
     MessageQueue mOutgoingQueue;
@@ -148,10 +259,23 @@ private:
     std::atomic<unsigned long long> mSentCount;
     std::atomic<unsigned long long> mReceivedCount;
 
+    Histogram mLatency[DISPATCH_STAGE_COUNT];
+    Histogram mDepth[DISPATCH_STAGE_COUNT];
+
     enum class DispatcherState { NotStarted,Queueing,Dispatching,Exiting,Exited };
     std::atomic<DispatcherState> mState;
     std::mutex mStateMutex;
     std::condition_variable mStateCondition;
+
+    // handler pool (optional)
+    struct PoolWorker {
+        PoolWorker(const std::string& label) : queue(label) {}
+        MessageQueue queue;
+        std::thread thread;
+    };
+    void workerThreadProc(PoolWorker& worker);
+    std::vector<std::unique_ptr<PoolWorker>> mPool;
+    HandlerOrdering mOrdering = HandlerOrdering::Sender;
 };
 
 }
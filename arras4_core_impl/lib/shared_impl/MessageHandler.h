@@ -14,7 +14,9 @@ class MessageHandler
 public:
     virtual ~MessageHandler() {}
     virtual void handleMessage(const api::Message& message)=0;
-    virtual void onIdle()=0;
+    // returns false if there was no idle work to do, allowing
+    // the dispatcher to call onIdle less often (see MessageDispatcher.h)
+    virtual bool onIdle()=0;
 };
 
 }
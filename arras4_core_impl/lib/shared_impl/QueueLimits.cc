@@ -0,0 +1,35 @@
+// Copyright 2023-2024 DreamWorks Animation LLC and Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "QueueLimits.h"
+
+namespace {
+    std::string OPS_Block("block");
+    std::string OPS_DropOldest("dropOldest");
+    std::string OPS_Reject("reject");
+}
+
+namespace arras4 {
+    namespace impl {
+
+bool overflowPolicyFromString(const std::string& s, OverflowPolicy& policy)
+{
+    if (s == OPS_Block)           policy = OverflowPolicy::Block;
+    else if (s == OPS_DropOldest) policy = OverflowPolicy::DropOldest;
+    else if (s == OPS_Reject)     policy = OverflowPolicy::Reject;
+    else return false;
+    return true;
+}
+
+std::string overflowPolicyAsString(OverflowPolicy policy)
+{
+    switch (policy) {
+    case OverflowPolicy::DropOldest: return OPS_DropOldest;
+    case OverflowPolicy::Reject:     return OPS_Reject;
+    default:
+        return OPS_Block;
+    }
+}
+
+}
+}
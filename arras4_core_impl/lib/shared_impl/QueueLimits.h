@@ -0,0 +1,51 @@
+// Copyright 2023-2024 DreamWorks Animation LLC and Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __ARRAS4_QUEUE_LIMITSH__
+#define __ARRAS4_QUEUE_LIMITSH__
+
+#include <cstddef>
+#include <string>
+
+namespace arras4 {
+    namespace impl {
+
+// what a bounded ThreadsafeQueue does when a push would take
+// it over its high watermark
+enum class OverflowPolicy {
+    // push blocks until the queue has drained to the low watermark
+    Block,
+    // the oldest items are discarded to make room
+    DropOldest,
+    // push throws QueueFullException, and continues to do so until
+    // the queue has drained to the low watermark
+    Reject
+};
+
+// parse "block", "dropOldest" or "reject". Returns false if the
+// string isn't recognized
+bool overflowPolicyFromString(const std::string& s, OverflowPolicy& policy);
+std::string overflowPolicyAsString(OverflowPolicy policy);
+
+// Limits for a bounded ThreadsafeQueue. maxItems and maxBytes are
+// the high watermark : a push that would take either count above its
+// limit triggers the overflow policy. Zero means no limit. The low
+// watermark is a percentage of the high watermark, and gives the
+// queue some hysteresis, so that a blocked producer isn't woken
+// for every item popped.
+//
+// An item is always accepted by an empty queue, even if it is
+// larger than maxBytes
+struct QueueLimits
+{
+    size_t maxItems = 0;
+    size_t maxBytes = 0;
+    unsigned lowWatermarkPercent = 75;
+    OverflowPolicy policy = OverflowPolicy::Block;
+
+    bool isLimited() const { return maxItems != 0 || maxBytes != 0; }
+};
+
+}
+}
+#endif
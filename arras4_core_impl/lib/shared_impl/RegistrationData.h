@@ -27,7 +27,10 @@ namespace arras4 {
             unsigned short mMessagingAPIVersionMajor;
             unsigned short mMessagingAPIVersionMinor;
             unsigned short mMessagingAPIVersionPatch;
-            unsigned short mReserved; // for alignment
+            // highest network::Frame header version the sender can receive.
+            // Was reserved (always 0) before large frames were supported,
+            // which corresponds to Frame::VERSION_BASIC
+            unsigned short mFrameVersion;
             
             // changes above this point may break protocol version checking
 
@@ -41,7 +44,7 @@ namespace arras4 {
                 mMessagingAPIVersionMajor(major),
                 mMessagingAPIVersionMinor(minor),
                 mMessagingAPIVersionPatch(patch),
-                mReserved(0) {};
+                mFrameVersion(0) {};
 
         };
 
@@ -4,25 +4,109 @@
 #ifndef __ARRAS4_THREADSAFE_QUEUEH__
 #define __ARRAS4_THREADSAFE_QUEUEH__
 
+#include "QueueLimits.h"
+
+#include <atomic>
 #include <condition_variable>
+#include <functional>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <deque>
 #include <queue>
+#include <vector>
 
 namespace arras4 {
     namespace impl {
 
-// simple mutexed implementation of a concurrent queue
+template<typename T> class LockFreeRing;
+
+enum class QueueMode {
+    // unbounded std::queue protected by a mutex
+    Locked,
+    // bounded lock-free ring (see LockFreeRing.h). Threads only take
+    // the mutex to sleep when the queue is empty (pop) or full (push)
+    LockFree
+};
+
+// ThreadsafeQueue has two lanes. High priority items are always popped
+// before Normal ones, and aren't subject to QueueLimits, so pushing one
+// never blocks, drops or rejects it. The High lane is intended for
+// small amounts of control and liveness traffic, and is always
+// a locked queue.
+//
+// That only holds for the push itself. A thread that is blocked
+// pushing a Normal item (OverflowPolicy::Block, or a full LockFree queue)
+// can't push anything else until it returns. So a producer that also
+// carries High items, e.g. a thread reading messages from a socket, 
+// shouldn't push to a queue that can block
+enum class QueuePriority {
+    High,
+    Normal
+};
+
+// default capacity of a LockFree queue
+constexpr size_t DEFAULT_LOCKFREE_QUEUE_CAPACITY = 4096;
+
+// concurrent queue, with a choice of implementation (see QueueMode).
+// In Locked mode the queue may also be bounded (see QueueLimits.h)
 template<typename T>
 class ThreadsafeQueue
 {
 public:
-    ThreadsafeQueue(const std::string& label="Queue") :
-        mLabel(label),
-        mShutdown(false) {}
-    ~ThreadsafeQueue() { shutdown(); }
+    // returns the size of an item in bytes, for QueueLimits::maxBytes
+    using SizeFunction = std::function<size_t(const T&)>;
+    // called with true when a bounded queue becomes full, and with
+    // false when it has drained to its low watermark
+    using WatermarkFunction = std::function<void(bool full)>;
+
+    ThreadsafeQueue(const std::string& label="Queue",
+                    QueueMode mode=QueueMode::Locked,
+                    size_t capacity=DEFAULT_LOCKFREE_QUEUE_CAPACITY);
+    ~ThreadsafeQueue();
+
+    // change the implementation. Only call this while the
+    // queue is empty and not being used by other threads
+    void setMode(QueueMode mode,
+                 size_t capacity=DEFAULT_LOCKFREE_QUEUE_CAPACITY);
+    QueueMode mode() const { return mMode; }
+
+    // bound the queue. 'sizeOf' is required if limits.maxBytes is
+    // set. 'onWatermark' is called with the queue mutex held, and so
+    // must not call back into the queue. Limits are only supported in
+    // Locked mode : throws std::logic_error in LockFree mode. Only
+    // call this while the queue is empty and not being used by
+    // other threads
+    void setLimits(const QueueLimits& limits,
+                   const SizeFunction& sizeOf = SizeFunction(),
+                   const WatermarkFunction& onWatermark = WatermarkFunction());
+    const QueueLimits& limits() const { return mLimits; }
 
-    void push(const T& t);
+    // current number of items queued, and their total size in bytes
+    // (only counted if there is a maxBytes limit)
+    size_t size() const;
+    size_t byteCount() const;
+
+    // number of items discarded by OverflowPolicy::DropOldest, and
+    // of pushes refused by OverflowPolicy::Reject
+    unsigned long long droppedCount() const { return mDroppedCount; }
+    unsigned long long rejectedCount() const { return mRejectedCount; }
+
+    // in LockFree mode, push blocks while the queue is full. In
+    // a bounded queue, push applies the overflow policy, and may throw
+    // QueueFullException
+    void push(const T& t, QueuePriority priority=QueuePriority::Normal);
+    void push(T&& t, QueuePriority priority=QueuePriority::Normal);
+
+    // pushes all the items in 'items', leaving it empty. In Locked mode
+    // the mutex is only taken once. If a bounded queue throws
+    // QueueFullException, the items before the rejected one have
+    // been pushed
+    void pushBatch(std::vector<T>& items,
+                   QueuePriority priority=QueuePriority::Normal);
+
+    // pops a High priority item if there is one, without waiting
+    bool tryPopHigh(T& t);
 
     // pop waits for a a maximum period of 'timeout'
     // for an item to be available on the queue for popping.
@@ -36,6 +120,15 @@ public:
              const std::chrono::microseconds& timeout =
              std::chrono::microseconds::zero());
 
+    // popBatch waits in the same way as pop() for an item to be
+    // available, then replaces the contents of 'out' with up to
+    // 'maxCount' items, High priority first. In Locked mode the
+    // mutex is only taken once. Returns the number of items popped,
+    // which is zero if the timeout expired
+    size_t popBatch(std::vector<T>& out, size_t maxCount,
+                    const std::chrono::microseconds& timeout =
+                    std::chrono::microseconds::zero());
+
     // blocks until the next time the queue is empty, the
     // timeout has expired or shutdown is called. Returns
     // true if terminated because queue was empty.
@@ -52,12 +145,47 @@ public:
 
 
 private:
+    void pushHigh(T&& t);
+    bool popHighLocked(T& t);
+    bool isEmptyLocked() const;
+    bool lockFreePop(T& t, const std::chrono::microseconds& timeout);
+    void afterLockFreePop();
+    size_t itemBytes(const T& t) const;
+    void reduceBytes(const T& t);
+    bool aboveHigh(size_t items, size_t bytes) const;
+    void makeRoom(std::unique_lock<std::mutex>& lock, size_t bytes);
+    void afterPop(const T& t);
+    void setFull(bool full);
+
     std::queue<T> mQueue;
-    std::mutex mMutex;
+    mutable std::mutex mMutex;
     std::condition_variable mEmptyCondition;
     std::condition_variable mNotEmptyCondition;
     std::string mLabel; // helps debugging
-    bool mShutdown;
+    std::atomic<bool> mShutdown;
+
+    // High priority lane
+    std::deque<T> mHigh;
+    std::atomic<size_t> mHighCount{0};
+
+    // LockFree mode
+    QueueMode mMode;
+    std::unique_ptr<LockFreeRing<T>> mRing;
+    std::condition_variable mNotFullCondition;
+    std::atomic<int> mPoppersWaiting{0};
+    std::atomic<int> mPushersWaiting{0};
+    std::atomic<int> mEmptyWaiters{0};
+
+    // bounded queue (Locked mode)
+    QueueLimits mLimits;
+    SizeFunction mSizeOf;
+    WatermarkFunction mOnWatermark;
+    size_t mLowItems = 0;
+    size_t mLowBytes = 0;
+    size_t mBytes = 0;
+    bool mFull = false;
+    std::atomic<unsigned long long> mDroppedCount{0};
+    std::atomic<unsigned long long> mRejectedCount{0};
 };
 
 }
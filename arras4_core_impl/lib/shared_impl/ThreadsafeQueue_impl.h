@@ -5,32 +5,253 @@
 #define __ARRAS4_THREADSAFE_QUEUE_IMPLH__
 
 #include "ThreadsafeQueue.h"
+#include "LockFreeRing.h"
+#include <exceptions/QueueFullException.h>
 #include <exceptions/ShutdownException.h>
 
+#include <algorithm>
+#include <stdexcept>
+
 namespace arras4 {
     namespace impl {
 
+// number of times a LockFree pop retries before sleeping
+constexpr int LOCKFREE_POP_SPIN = 100;
+
+template<typename T>
+ThreadsafeQueue<T>::ThreadsafeQueue(const std::string& label,
+                                    QueueMode mode,
+                                    size_t capacity) :
+    mLabel(label),
+    mShutdown(false),
+    mMode(QueueMode::Locked)
+{
+    setMode(mode, capacity);
+}
+
+template<typename T>
+ThreadsafeQueue<T>::~ThreadsafeQueue()
+{
+    shutdown();
+}
+
+template<typename T>
+void ThreadsafeQueue<T>::setMode(QueueMode mode, size_t capacity)
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    if (mode == QueueMode::LockFree && mLimits.isLimited())
+        throw std::logic_error("Queue " + mLabel + " : bounded queues cannot use LockFree mode");
+    mMode = mode;
+    if (mode == QueueMode::LockFree)
+        mRing.reset(new LockFreeRing<T>(capacity));
+    else
+        mRing.reset();
+}
+
+template<typename T>
+void ThreadsafeQueue<T>::setLimits(const QueueLimits& limits,
+                                   const SizeFunction& sizeOf,
+                                   const WatermarkFunction& onWatermark)
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    if (mMode == QueueMode::LockFree && limits.isLimited())
+        throw std::logic_error("Queue " + mLabel + " : bounded queues cannot use LockFree mode");
+    if (limits.maxBytes && !sizeOf)
+        throw std::logic_error("Queue " + mLabel + " : a byte limit requires a size function");
+    mLimits = limits;
+    mSizeOf = sizeOf;
+    mOnWatermark = onWatermark;
+    unsigned percent = limits.lowWatermarkPercent < 100 ? limits.lowWatermarkPercent : 100;
+    mLowItems = limits.maxItems * percent / 100;
+    mLowBytes = limits.maxBytes * percent / 100;
+}
+
+template<typename T>
+size_t ThreadsafeQueue<T>::size() const
+{
+    if (mMode == QueueMode::LockFree)
+        return mRing->size() + mHighCount;
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mQueue.size() + mHigh.size();
+}
+
+template<typename T>
+size_t ThreadsafeQueue<T>::byteCount() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mBytes;
+}
+
 template<typename T>
-void ThreadsafeQueue<T>::push(const T& t)
+void ThreadsafeQueue<T>::push(const T& t, QueuePriority priority)
 {
+    T copy(t);
+    push(std::move(copy), priority);
+}
+
+template<typename T>
+void ThreadsafeQueue<T>::push(T&& t, QueuePriority priority)
+{
+    if (priority == QueuePriority::High) {
+        pushHigh(std::move(t));
+        return;
+    }
+    if (mMode == QueueMode::LockFree) {
+        if (mShutdown) {
+            throw ShutdownException("Queue was shut down");
+        }
+        while (!mRing->tryPush(t)) {
+            // queue is full : wait until it has drained to half
+            // capacity, so that pushers and poppers don't wake each
+            // other for every item
+            std::unique_lock<std::mutex> lock(mMutex);
+            mPushersWaiting++;
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            while (mRing->size() > mRing->capacity() / 2 && !mShutdown)
+                mNotFullCondition.wait(lock);
+            mPushersWaiting--;
+            if (mShutdown) {
+                throw ShutdownException("Queue was shut down");
+            }
+        }
+        // wake a sleeping pop. The fence pairs with the one in lockFreePop(),
+        // so that either we see the popper waiting or it sees our item
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (mPoppersWaiting.load()) {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mNotEmptyCondition.notify_one();
+        }
+        return;
+    }
+
+    // measure outside the lock, since it may be expensive
+    size_t bytes = itemBytes(t);
     std::unique_lock<std::mutex> lock(mMutex);
     if (mShutdown) {
         throw ShutdownException("Queue was shut down");
     }
-    mQueue.push(t);
+    if (mLimits.isLimited())
+        makeRoom(lock, bytes);
+    mQueue.push(std::move(t));
+    mBytes += bytes;
     lock.unlock();
     mNotEmptyCondition.notify_one();
 }
 
+template<typename T>
+void ThreadsafeQueue<T>::pushBatch(std::vector<T>& items, QueuePriority priority)
+{
+    if (items.empty())
+        return;
+    if (priority == QueuePriority::High || mMode == QueueMode::LockFree) {
+        for (T& t : items)
+            push(std::move(t), priority);
+        items.clear();
+        return;
+    }
+
+    // measure outside the lock, since it may be expensive
+    std::vector<size_t> bytes;
+    if (mLimits.maxBytes && mSizeOf) {
+        bytes.reserve(items.size());
+        for (const T& t : items)
+            bytes.push_back(mSizeOf(t));
+    }
+    std::unique_lock<std::mutex> lock(mMutex);
+    if (mShutdown) {
+        throw ShutdownException("Queue was shut down");
+    }
+    size_t pushed = 0;
+    try {
+        for (; pushed < items.size(); pushed++) {
+            size_t itemBytes = bytes.empty() ? 0 : bytes[pushed];
+            if (mLimits.isLimited())
+                makeRoom(lock, itemBytes);
+            mQueue.push(std::move(items[pushed]));
+            mBytes += itemBytes;
+        }
+    } catch (...) {
+        items.clear();
+        lock.unlock();
+        if (pushed)
+            mNotEmptyCondition.notify_all();
+        throw;
+    }
+    items.clear();
+    lock.unlock();
+    if (pushed == 1)
+        mNotEmptyCondition.notify_one();
+    else
+        mNotEmptyCondition.notify_all();
+}
+
+// the High lane is used in both modes. In LockFree mode, mHighCount
+// lets poppers skip the mutex when the lane is empty. Pushing under the
+// mutex means a popper checking the lane before it sleeps can't miss
+// the notification
+template<typename T>
+void ThreadsafeQueue<T>::pushHigh(T&& t)
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    if (mShutdown) {
+        throw ShutdownException("Queue was shut down");
+    }
+    mHigh.push_back(std::move(t));
+    mHighCount++;
+    mNotEmptyCondition.notify_all();
+}
+
+// called with mMutex locked
+template<typename T>
+bool ThreadsafeQueue<T>::popHighLocked(T& t)
+{
+    if (mHigh.empty())
+        return false;
+    t = std::move(mHigh.front());
+    mHigh.pop_front();
+    mHighCount--;
+    return true;
+}
+
+template<typename T>
+bool ThreadsafeQueue<T>::tryPopHigh(T& t)
+{
+    if (mHighCount == 0)
+        return false;
+    std::unique_lock<std::mutex> lock(mMutex);
+    if (mShutdown) {
+        throw ShutdownException("Queue was shut down");
+    }
+    if (!popHighLocked(t))
+        return false;
+    if (isEmptyLocked())
+        mEmptyCondition.notify_all();
+    return true;
+}
+
+// called with mMutex locked
+template<typename T>
+bool ThreadsafeQueue<T>::isEmptyLocked() const
+{
+    if (!mHigh.empty())
+        return false;
+    if (mMode == QueueMode::LockFree)
+        return mRing->empty();
+    return mQueue.empty();
+}
+
 template<typename T>
 bool ThreadsafeQueue<T>::pop(T& t,
                           const std::chrono::microseconds& timeout)
 {
+    if (mMode == QueueMode::LockFree)
+        return lockFreePop(t, timeout);
+
     std::unique_lock<std::mutex> lock(mMutex);
     if (mShutdown) {
         throw ShutdownException("Queue was shut down");
     }
-    while (mQueue.empty()) {
+    while (mQueue.empty() && mHigh.empty()) {
         if (timeout == std::chrono::microseconds::zero()) {
             mNotEmptyCondition.wait(lock);
         } else {
@@ -42,43 +263,248 @@ bool ThreadsafeQueue<T>::pop(T& t,
             throw ShutdownException("Queue was shut down");
         }
     }
-    t = mQueue.front();
-    mQueue.pop();
-    if (mQueue.empty())
+    if (!popHighLocked(t)) {
+        t = std::move(mQueue.front());
+        mQueue.pop();
+        if (mLimits.isLimited())
+            afterPop(t);
+    }
+    if (isEmptyLocked())
         mEmptyCondition.notify_all();
     return true;
 }
 
 template<typename T>
-bool ThreadsafeQueue<T>::waitUntilEmpty(const std::chrono::microseconds& timeout)
+size_t ThreadsafeQueue<T>::popBatch(std::vector<T>& out, size_t maxCount,
+                                    const std::chrono::microseconds& timeout)
 {
+    out.clear();
+    if (maxCount == 0)
+        return 0;
+
+    if (mMode == QueueMode::LockFree) {
+        T t;
+        if (!lockFreePop(t, timeout))
+            return 0;
+        out.push_back(std::move(t));
+        while (out.size() < maxCount &&
+               (tryPopHigh(t) || mRing->tryPop(t)))
+            out.push_back(std::move(t));
+        afterLockFreePop();
+        return out.size();
+    }
+
     std::unique_lock<std::mutex> lock(mMutex);
     if (mShutdown) {
         throw ShutdownException("Queue was shut down");
     }
-    while (!mQueue.empty()) {
+    while (mQueue.empty() && mHigh.empty()) {
         if (timeout == std::chrono::microseconds::zero()) {
-            mEmptyCondition.wait(lock);
+            mNotEmptyCondition.wait(lock);
         } else {
-            std::cv_status cvs = mEmptyCondition.wait_for(lock,timeout);
+            std::cv_status cvs = mNotEmptyCondition.wait_for(lock,timeout);
             if (cvs == std::cv_status::timeout)
-                return false;
+                return 0;
         }
         if (mShutdown) {
             throw ShutdownException("Queue was shut down");
         }
     }
-    return true;
+    out.reserve(std::min(maxCount, mQueue.size() + mHigh.size()));
+    T t;
+    while (out.size() < maxCount && popHighLocked(t))
+        out.push_back(std::move(t));
+    while (out.size() < maxCount && !mQueue.empty()) {
+        out.push_back(std::move(mQueue.front()));
+        mQueue.pop();
+        if (mLimits.isLimited())
+            afterPop(out.back());
+    }
+    if (isEmptyLocked())
+        mEmptyCondition.notify_all();
+    return out.size();
+}
+
+template<typename T>
+size_t ThreadsafeQueue<T>::itemBytes(const T& t) const
+{
+    if (mLimits.maxBytes && mSizeOf)
+        return mSizeOf(t);
+    return 0;
+}
+
+template<typename T>
+void ThreadsafeQueue<T>::reduceBytes(const T& t)
+{
+    size_t bytes = itemBytes(t);
+    mBytes = bytes < mBytes ? mBytes - bytes : 0;
+}
+
+template<typename T>
+bool ThreadsafeQueue<T>::aboveHigh(size_t items, size_t bytes) const
+{
+    return (mLimits.maxItems && items > mLimits.maxItems) ||
+        (mLimits.maxBytes && bytes > mLimits.maxBytes);
+}
+
+// apply the overflow policy until there is room to push an item
+// of size 'bytes'. Called with mMutex locked
+template<typename T>
+void ThreadsafeQueue<T>::makeRoom(std::unique_lock<std::mutex>& lock, size_t bytes)
+{
+    while (!mQueue.empty()) {
+        // Block and Reject continue to apply until the
+        // queue has drained to the low watermark
+        bool over = aboveHigh(mQueue.size() + 1, mBytes + bytes);
+        if (!over && !(mFull && mLimits.policy != OverflowPolicy::DropOldest))
+            break;
+        setFull(true);
+        switch (mLimits.policy) {
+        case OverflowPolicy::DropOldest:
+            reduceBytes(mQueue.front());
+            mQueue.pop();
+            mDroppedCount++;
+            break;
+        case OverflowPolicy::Reject:
+            mRejectedCount++;
+            throw QueueFullException("Queue " + mLabel + " is full");
+        default:
+            mNotFullCondition.wait(lock);
+            if (mShutdown) {
+                throw ShutdownException("Queue was shut down");
+            }
+        }
+    }
+}
+
+// update the byte count after popping 't', and release
+// blocked pushers if the queue has drained to the low watermark.
+// Called with mMutex locked
+template<typename T>
+void ThreadsafeQueue<T>::afterPop(const T& t)
+{
+    reduceBytes(t);
+    if (mFull &&
+        (!mLimits.maxItems || mQueue.size() <= mLowItems) &&
+        (!mLimits.maxBytes || mBytes <= mLowBytes)) {
+        setFull(false);
+        mNotFullCondition.notify_all();
+    }
+}
+
+template<typename T>
+void ThreadsafeQueue<T>::setFull(bool full)
+{
+    if (mFull != full) {
+        mFull = full;
+        if (mOnWatermark)
+            mOnWatermark(full);
+    }
+}
+
+template<typename T>
+bool ThreadsafeQueue<T>::lockFreePop(T& t,
+                                     const std::chrono::microseconds& timeout)
+{
+    if (mShutdown) {
+        throw ShutdownException("Queue was shut down");
+    }
+    if (tryPopHigh(t))
+        return true;
+    for (int i = 0; i < LOCKFREE_POP_SPIN; i++) {
+        if (mRing->tryPop(t)) {
+            afterLockFreePop();
+            return true;
+        }
+    }
+
+    // queue is empty : sleep until a push wakes us
+    std::chrono::steady_clock::time_point deadline =
+        std::chrono::steady_clock::now() + timeout;
+    std::unique_lock<std::mutex> lock(mMutex);
+    mPoppersWaiting++;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    bool popped = false;
+    while (!(popped = popHighLocked(t) || mRing->tryPop(t))) {
+        if (mShutdown)
+            break;
+        if (timeout == std::chrono::microseconds::zero()) {
+            mNotEmptyCondition.wait(lock);
+        } else if (mNotEmptyCondition.wait_until(lock,deadline) == std::cv_status::timeout) {
+            popped = popHighLocked(t) || mRing->tryPop(t);
+            break;
+        }
+    }
+    mPoppersWaiting--;
+    lock.unlock();
+    if (popped) {
+        afterLockFreePop();
+        return true;
+    }
+    if (mShutdown) {
+        throw ShutdownException("Queue was shut down");
+    }
+    return false;
+}
+
+// wake any threads waiting for space or for the queue to empty
+template<typename T>
+void ThreadsafeQueue<T>::afterLockFreePop()
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (mPushersWaiting.load() && mRing->size() <= mRing->capacity() / 2) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mNotFullCondition.notify_all();
+    }
+    if (mEmptyWaiters.load() && mRing->empty() && mHighCount == 0) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mEmptyCondition.notify_all();
+    }
+}
+
+template<typename T>
+bool ThreadsafeQueue<T>::waitUntilEmpty(const std::chrono::microseconds& timeout)
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    if (mShutdown) {
+        throw ShutdownException("Queue was shut down");
+    }
+    bool lockFree = (mMode == QueueMode::LockFree);
+    if (lockFree) {
+        mEmptyWaiters++;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+    bool isEmpty = true;
+    while (!isEmptyLocked()) {
+        if (timeout == std::chrono::microseconds::zero()) {
+            mEmptyCondition.wait(lock);
+        } else {
+            std::cv_status cvs = mEmptyCondition.wait_for(lock,timeout);
+            if (cvs == std::cv_status::timeout) {
+                isEmpty = false;
+                break;
+            }
+        }
+        if (mShutdown)
+            break;
+    }
+    if (lockFree)
+        mEmptyWaiters--;
+    if (mShutdown) {
+        throw ShutdownException("Queue was shut down");
+    }
+    return isEmpty;
 }
 
 template<typename T>
 void ThreadsafeQueue<T>::shutdown()
-{   
+{
     std::unique_lock<std::mutex> lock(mMutex);
     mShutdown = true;
     lock.unlock();
     mNotEmptyCondition.notify_all();
     mEmptyCondition.notify_all();
+    mNotFullCondition.notify_all();
 }
 
 }
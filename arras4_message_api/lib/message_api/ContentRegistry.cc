@@ -3,8 +3,30 @@
 
 #include "ContentRegistry.h"
 
+#include <algorithm>
+
+namespace {
+
+typedef std::pair<arras4::api::ClassID,const arras4::api::ContentFactory*> Entry;
+
+bool entryLess(const Entry& entry, const arras4::api::ClassID& classId)
+{
+    return entry.first < classId;
+}
+
+}
+
 namespace arras4 {
     namespace api {
+
+ContentRegistry::ContentRegistry()
+    : mTable(nullptr)
+{
+}
+
+ContentRegistry::~ContentRegistry()
+{
+}
   
 /*static*/ ContentRegistry* ContentRegistry::singleton()
 {
@@ -15,16 +37,25 @@ namespace arras4 {
 void ContentRegistry::registerFactory(const ClassID& classId,const ContentFactory* factory)
 {
     if (factory) {
-        std::lock_guard<std::mutex> lock(mMutex);
-        mMap.insert(std::map<ClassID,const ContentFactory*>::value_type(classId,factory));
+        std::lock_guard<std::mutex> lock(mRegisterMutex);
+        const Table* current = mTable.load(std::memory_order_acquire);
+        std::unique_ptr<Table> table(current ? new Table(*current) : new Table);
+        auto it = std::lower_bound(table->begin(), table->end(), classId, entryLess);
+        if (it != table->end() && it->first == classId)
+            return; // first registration of a class id wins
+        table->insert(it, Entry(classId,factory));
+        mTable.store(table.get(), std::memory_order_release);
+        mTables.emplace_back(std::move(table));
     }
 }
 
 ObjectContent* ContentRegistry::create(const ClassID& classId, unsigned version) const
 {
-    std::lock_guard<std::mutex> lock(mMutex);
-    auto it = mMap.find(classId);
-    if (it == mMap.end())
+    const Table* table = mTable.load(std::memory_order_acquire);
+    if (!table)
+        return nullptr;
+    auto it = std::lower_bound(table->begin(), table->end(), classId, entryLess);
+    if (it == table->end() || !(it->first == classId))
         return nullptr;
     else
         return it->second->create(version);
@@ -7,16 +7,26 @@
 #include "messageapi_types.h"
 #include "UUID.h"
 
+#include <atomic>
 #include <string>
 #include <memory>
 #include <mutex>
-#include <map>
+#include <utility>
+#include <vector>
 
 // ContentRegistry allows Arras to deserialize message content into
 // ObjectContent instances. The registry can create a new ObjectContent 
 // instance, given the class id from the message. 
 // ObjectContent subclasses are usually registered automatically during 
 // static initialization, via a mechanism defined in ContentMacros.h
+//
+// create() is called for every message that is deserialized, often on
+// several threads at once, while registration only happens when libraries
+// are loaded. So lookups use an immutable table, sorted by class id, that
+// is published atomically : they never take a lock. Registering a factory
+// copies the table, adds the new entry and publishes the copy. Replaced
+// tables are kept until the registry is destroyed, since a lookup may
+// still be using them.
 
 namespace arras4 {
     namespace api {
@@ -38,13 +48,25 @@ class ContentRegistry
 {
 public:
     
+    ContentRegistry();
+    ~ContentRegistry();
+
+    ContentRegistry(const ContentRegistry&) = delete;
+    ContentRegistry& operator=(const ContentRegistry&) = delete;
+
     static ContentRegistry* singleton();
     void registerFactory(const ClassID& classId,const ContentFactory* cls);
     ObjectContent* create(const ClassID& classId, unsigned version) const;
  
 private:
-    mutable std::mutex mMutex;
-    std::map<ClassID,const ContentFactory*> mMap;
+    typedef std::vector<std::pair<ClassID,const ContentFactory*>> Table;
+
+    // current table, read without locking
+    std::atomic<const Table*> mTable;
+
+    // serializes registration, and owns all tables
+    std::mutex mRegisterMutex;
+    std::vector<std::unique_ptr<const Table>> mTables;
 };
 
     }
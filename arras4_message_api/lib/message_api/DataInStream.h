@@ -8,6 +8,11 @@
 #include <cstdint>
 #include <string>
 #include <cassert>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#include "MessageFormatError.h"
 
 namespace arras4
 {
@@ -48,6 +53,53 @@ public:
     static_assert(sizeof(unsigned long) == sizeof(uint64_t));
     virtual size_t read(unsigned long& val)=0;
 #endif
+
+    // read 'aCount' elements of 'aElemSize' bytes, storing them
+    // 'aStride' bytes apart in memory. Counterpart of
+    // DataOutStream::writeStrided()
+    virtual size_t readStrided(void* aBuf, size_t aElemSize,
+                               size_t aCount, size_t aStride) {
+        if (aStride == aElemSize)
+            return read(aBuf, aElemSize * aCount);
+        unsigned char* p = static_cast<unsigned char*>(aBuf);
+        size_t bytesRead = 0;
+        for (size_t i = 0; i < aCount; i++, p += aStride)
+            bytesRead += read(p, aElemSize);
+        return bytesRead;
+    }
+
+    // read an array written by DataOutStream::writeArray() or
+    // writeStridedArray(), replacing the contents of 'aVec'
+    template <typename T> size_t readArray(std::vector<T>& aVec) {
+        uint64_t count = readArrayCount<T>();
+        aVec.resize(static_cast<size_t>(count)); // this can throw std::bad_alloc
+        return sizeof(count) + read(static_cast<void*>(aVec.data()),
+                                    aVec.size() * sizeof(T));
+    }
+
+    // read an array into existing storage of 'aMaxCount' elements, 
+    // spaced 'aStride' bytes apart (sizeof(T) if 0). Sets aCount to the 
+    // number read. Throws MessageFormatError if the array is too long
+    template <typename T> size_t readArray(T* aData, size_t aMaxCount,
+                                           size_t& aCount, size_t aStride = 0) {
+        uint64_t count = readArrayCount<T>();
+        if (count > aMaxCount)
+            throw MessageFormatError("Serialized array is longer than the space provided");
+        aCount = static_cast<size_t>(count);
+        return sizeof(count) + readStrided(aData, sizeof(T), aCount,
+                                           aStride ? aStride : sizeof(T));
+    }
+
+private:
+    template <typename T> uint64_t readArrayCount() {
+        static_assert(std::is_trivially_copyable<T>::value,
+                      "readArray requires a trivially copyable element type");
+        uint64_t count = 0;
+        read(count);
+        if (count > std::numeric_limits<size_t>::max() / sizeof(T))
+            throw MessageFormatError("Serialized array length is invalid");
+        return count;
+    }
 };
 
 // alternate interface using >> operator
@@ -8,6 +8,8 @@
 #include <cstdint>
 #include <string>
 #include <cassert>
+#include <type_traits>
+#include <vector>
 
 namespace arras4
 {
@@ -53,6 +55,45 @@ public:
     static_assert(sizeof(unsigned long) == sizeof(uint64_t));
     virtual size_t write(unsigned long val)=0;
 #endif
+
+    // write 'aCount' elements of 'aElemSize' bytes, taken from memory
+    // 'aStride' bytes apart (e.g. one field from an array of structs).
+    // Only the element data is written. Implementations override this
+    // to avoid a call per element
+    virtual size_t writeStrided(const void* aBuf, size_t aElemSize,
+                                size_t aCount, size_t aStride) {
+        if (aStride == aElemSize)
+            return write(aBuf, aElemSize * aCount);
+        const unsigned char* p = static_cast<const unsigned char*>(aBuf);
+        size_t written = 0;
+        for (size_t i = 0; i < aCount; i++, p += aStride)
+            written += write(p, aElemSize);
+        return written;
+    }
+
+    // Arrays of trivially copyable values are written as a uint64_t
+    // element count followed by the elements in their memory
+    // representation, and read back with DataInStream::readArray()
+    template <typename T> size_t writeArray(const T* aData, size_t aCount) {
+        static_assert(std::is_trivially_copyable<T>::value,
+                      "writeArray requires a trivially copyable element type");
+        size_t written = write(static_cast<uint64_t>(aCount));
+        return written + write(static_cast<const void*>(aData), aCount * sizeof(T));
+    }
+    template <typename T> size_t writeArray(const std::vector<T>& aVec) {
+        return writeArray(aVec.data(), aVec.size());
+    }
+
+    // write one member of each element of an array of structs,
+    // in the same format as writeArray(), e.g.
+    //    writeStridedArray(&points[0].x, points.size(), sizeof(Point))
+    template <typename T> size_t writeStridedArray(const T* aFirst, size_t aCount,
+                                                   size_t aStride) {
+        static_assert(std::is_trivially_copyable<T>::value,
+                      "writeStridedArray requires a trivially copyable element type");
+        size_t written = write(static_cast<uint64_t>(aCount));
+        return written + writeStrided(aFirst, sizeof(T), aCount, aStride);
+    }
 };
 
 // alternate interface using << operator
@@ -26,6 +26,25 @@ public:
         if (mMetadata) return mMetadata->get(optionName);
         else return Object();
     }
+
+    // typed access to message data (see Metadata), returning
+    // null values if there is no metadata
+    UUID instanceId() const {
+        if (mMetadata) return mMetadata->getInstanceId();
+        else return UUID();
+    }
+    UUID sourceId() const {
+        if (mMetadata) return mMetadata->getSourceId();
+        else return UUID();
+    }
+    Address from() const {
+        if (mMetadata) return mMetadata->getFrom();
+        else return Address();
+    }
+    std::string routingName() const {
+        if (mMetadata) return mMetadata->getRoutingName();
+        else return std::string();
+    }
    
     std::string describe() const { 
         if (mMetadata) return mMetadata->describe();
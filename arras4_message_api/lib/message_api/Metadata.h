@@ -9,6 +9,7 @@
 #include "Address.h"
 #include "ArrasTime.h"
 #include "Object.h"
+#include "messageapi_names.h"
 
 namespace arras4 {
     namespace api {
@@ -22,6 +23,39 @@ public:
     virtual void toObject(ObjectRef obj)=0;
     virtual void fromObject(ObjectConstRef obj)=0;
 
+    // typed access to the standard message data. get() returns the
+    // same values, but builds a new Object on every call, so
+    // implementations should override these to read their fields 
+    // directly. The defaults are built on get(), so that existing 
+    // implementations still work. These come after the original
+    // virtual functions to keep the layout of the interface.
+    virtual UUID getInstanceId() const {
+        Object val = get(MessageData::instanceId);
+        return val.isString() ? UUID(val.asString()) : UUID();
+    }
+    virtual UUID getSourceId() const {
+        Object val = get(MessageData::sourceId);
+        return val.isString() ? UUID(val.asString()) : UUID();
+    }
+    virtual ArrasTime getCreationTime() const {
+        Object secs = get(MessageData::creationTimeSecs);
+        Object micros = get(MessageData::creationTimeMicroSecs);
+        if (!secs.isIntegral() || !micros.isIntegral())
+            return ArrasTime();
+        return ArrasTime(secs.asInt(), micros.asInt());
+    }
+    virtual Address getFrom() const {
+        Address addr;
+        Object val = get(MessageData::from);
+        if (val.isObject())
+            addr.fromObject(val);
+        return addr;
+    }
+    virtual std::string getRoutingName() const {
+        Object val = get(MessageData::routingName);
+        return val.isString() ? val.asString() : std::string();
+    }
+
 protected:
     Metadata() {}
     Metadata(const Metadata&)=delete;
@@ -5,7 +5,17 @@
 #include "FramingError.h"
 #include "Frame.h"
 
-#include <limits>
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+// frames up to this size are coalesced in a batch
+constexpr size_t MAX_COALESCED_FRAME = 16*1024;
+// the coalescing buffer is sent when it would exceed this size
+constexpr size_t MAX_COALESCED_BYTES = 64*1024;
+
+}
 
 namespace arras4 {
     namespace network {
@@ -20,6 +30,11 @@ BasicFramingSink::~BasicFramingSink()
 {
 }
 
+void BasicFramingSink::setFrameVersion(unsigned version)
+{
+    mFrameVersion = std::min(version, Frame::VERSION_CURRENT);
+}
+
 size_t BasicFramingSink::bytesWritten() const
 {
     return mBytesWritten;
@@ -39,15 +54,21 @@ void BasicFramingSink::flush()
     mOutputSink.flush();
 }
 
-bool BasicFramingSink::openFrame(size_t frameSize)
+void BasicFramingSink::fillHeader(Frame& frameHdr, size_t frameSize)
 {
-    if (frameSize > std::numeric_limits<unsigned int>::max())
-        throw FramingError("Data is too long for the framing protocol. Limit is ~2Gb");
+    if (frameSize > Frame::maxLength(mFrameVersion))
+        throw FramingError("Data is too long for the framing protocol. Limit is ~4Gb unless the receiver supports large frames");
     
-    Frame frameHdr;
     frameHdr.mType = Frame::FRAME_BINARY;
-    frameHdr.mLength = (unsigned)frameSize;
-    frameHdr.mReserved1 = frameHdr.mReserved2 = 0;
+    frameHdr.setLength(frameSize);
+}
+
+bool BasicFramingSink::openFrame(size_t frameSize)
+{
+    if (!sendPending())
+        return false;
+    Frame frameHdr;
+    fillHeader(frameHdr, frameSize);
     size_t w = mOutputSink.write(reinterpret_cast<unsigned char*>(&frameHdr), sizeof(frameHdr));
     if (w) {
         mFrameSize = frameSize;
@@ -66,6 +87,70 @@ bool BasicFramingSink::closeFrame()
     return true;
 }
 
+bool BasicFramingSink::writeFrame(const DataSegment* aSegments, size_t aCount)
+{
+    size_t frameSize = 0;
+    for (size_t i = 0; i < aCount; i++)
+        frameSize += aSegments[i].length;
+
+    Frame frameHdr;
+    fillHeader(frameHdr, frameSize);
+
+    if (mBatching && frameSize <= MAX_COALESCED_FRAME) {
+        if (mPending.size() + sizeof(frameHdr) + frameSize > MAX_COALESCED_BYTES &&
+            !sendPending())
+            return false;
+        const unsigned char* hdr = reinterpret_cast<const unsigned char*>(&frameHdr);
+        mPending.insert(mPending.end(), hdr, hdr + sizeof(frameHdr));
+        for (size_t i = 0; i < aCount; i++)
+            mPending.insert(mPending.end(), aSegments[i].data, 
+                            aSegments[i].data + aSegments[i].length);
+        return true;
+    }
+
+    // header goes out as the first segment, so that
+    // header and data can share a single send. Anything
+    // pending from a batch goes out ahead of it
+    std::vector<DataSegment> segments;
+    segments.reserve(aCount + 2);
+    if (!mPending.empty())
+        segments.push_back({ mPending.data(), mPending.size() });
+    segments.push_back({ reinterpret_cast<const unsigned char*>(&frameHdr), sizeof(frameHdr) });
+    for (size_t i = 0; i < aCount; i++) {
+        if (aSegments[i].length)
+            segments.push_back(aSegments[i]);
+    }
+
+    size_t w = mOutputSink.writeSegments(segments.data(), segments.size());
+    mFrameSize = 0;
+    mBytesWritten = 0;
+    if (w == 0) return false;
+    mPending.clear();
+    return true;
+}
+
+void BasicFramingSink::beginBatch()
+{
+    mBatching = true;
+}
+
+bool BasicFramingSink::endBatch()
+{
+    mBatching = false;
+    return sendPending();
+}
+
+bool BasicFramingSink::sendPending()
+{
+    if (mPending.empty())
+        return true;
+    DataSegment segment = { mPending.data(), mPending.size() };
+    if (mOutputSink.writeSegments(&segment, 1) == 0)
+        return false;
+    mPending.clear();
+    return true;
+}
+
 
 }
 }
@@ -6,9 +6,13 @@
 
 #include "DataSink.h"
 
+#include <vector>
+
 namespace arras4 {
     namespace network {
 
+class Frame;
+
 // Adds framing to an unframed sink,
 // using the Arras BasicFraming protocol
 class BasicFramingSink : public FramedSink
@@ -26,13 +30,38 @@ public:
     bool openFrame(size_t frameSize);
     bool closeFrame();
 
+    // sends the frame header and all segments to the 
+    // output sink as a single scatter-gather write
+    bool writeFrame(const DataSegment* aSegments, size_t aCount);
+
+    // highest frame header version that the receiver understands
+    // (see Frame.h). Defaults to Frame::VERSION_BASIC, which limits
+    // frames to 4Gb.
+    void setFrameVersion(unsigned version);
+    unsigned frameVersion() const { return mFrameVersion; }
+
+    // between beginBatch() and endBatch(), small frames passed to
+    // writeFrame() are copied into a coalescing buffer instead of being
+    // sent immediately, so that a run of small messages goes out
+    // in fewer writes. The buffer is sent when it fills, ahead of
+    // any frame that is too large to coalesce, and by endBatch().
+    // endBatch() returns false on timeout
+    void beginBatch();
+    bool endBatch();
+
 private:
+    void fillHeader(Frame& frameHdr, size_t frameSize);
+    bool sendPending();
 
     size_t remaining() { return mFrameSize - mBytesWritten; }
 
     DataSink& mOutputSink;
     size_t mBytesWritten = 0;
     size_t mFrameSize = 0;
+    unsigned mFrameVersion = 0; // Frame::VERSION_BASIC
+
+    bool mBatching = false;
+    std::vector<unsigned char> mPending;
 };
 
 }
@@ -47,7 +47,9 @@ size_t BasicFramingSource::nextFrame()
    Frame frameHdr;
    size_t r = mInputSource.read(reinterpret_cast<unsigned char*>(&frameHdr),sizeof(frameHdr));
    if (r) {
-       mFrameSize = frameHdr.mLength;
+       if (frameHdr.mVersion > Frame::VERSION_CURRENT)
+           throw FramingError("Unsupported frame header version");
+       mFrameSize = frameHdr.length();
        mBytesRead = 0;
        return mFrameSize;
    } else {
@@ -77,6 +77,8 @@ public:
         mOwnsData = false;
     }
 
+    bool ownsData() const { return mOwnsData; }
+
     size_t write(const unsigned char* data, size_t length) {
         length = std::min(length,static_cast<size_t>(mFinal-mEnd));
         if (length > 0)
@@ -114,6 +116,19 @@ public:
 
     void flush() {}
 
+    unsigned char* writeWindow(size_t& available) {
+        available = remainingCapacity();
+        return mEnd;
+    }
+    void commitWrite(size_t length) {
+        mEnd += std::min(length,static_cast<size_t>(mFinal-mEnd));
+    }
+    const unsigned char* readWindow(size_t& available) {
+        available = remaining();
+        return mStart;
+    }
+    void commitRead(size_t length) { skip(length); }
+
     unsigned char* initial() { return mData; }
     const unsigned char* initial() const { return mData; }
     unsigned char* start() { return mStart; }
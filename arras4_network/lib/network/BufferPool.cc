@@ -0,0 +1,126 @@
+// Copyright 2023-2024 DreamWorks Animation LLC and Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "BufferPool.h"
+#include "Buffer.h"
+#include "OutOfMemoryError.h"
+
+namespace arras4 {
+    namespace network {
+
+std::shared_ptr<BufferPool> BufferPool::create(size_t maxPooledSize,
+                                               size_t maxPooledBytes)
+{
+    return std::shared_ptr<BufferPool>(new BufferPool(maxPooledSize, maxPooledBytes));
+}
+
+const std::shared_ptr<BufferPool>& BufferPool::defaultPool()
+{
+    static std::shared_ptr<BufferPool> pool = create();
+    return pool;
+}
+
+BufferPool::BufferPool(size_t maxPooledSize, size_t maxPooledBytes) :
+    mMaxPooledSize(maxPooledSize),
+    mMaxPooledBytes(maxPooledBytes),
+    mFree(sizeClass(maxPooledSize) + 1)
+{
+}
+
+BufferPool::~BufferPool()
+{
+    trim();
+}
+
+// index of the smallest size class that holds 'size' bytes
+size_t BufferPool::sizeClass(size_t size)
+{
+    size_t index = 0;
+    size_t classSize = MIN_POOLED_SIZE;
+    while (classSize < size) {
+        classSize <<= 1;
+        index++;
+    }
+    return index;
+}
+
+BufferPtr BufferPool::acquire(size_t size)
+{
+    if (size > mMaxPooledSize) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStats.unpooled++;
+    } else {
+        size_t index = sizeClass(size);
+        Buffer* buffer = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            std::vector<Buffer*>& freeList = mFree[index];
+            if (freeList.empty()) {
+                mStats.misses++;
+            } else {
+                buffer = freeList.back();
+                freeList.pop_back();
+                mStats.hits++;
+                mStats.pooledBytes -= buffer->capacity();
+            }
+        }
+        try {
+            if (!buffer)
+                buffer = new Buffer(MIN_POOLED_SIZE << index);
+        } catch (std::bad_alloc&) {
+            throw OutOfMemoryError("Buffer allocation failed : out of memory?");
+        }
+        std::weak_ptr<BufferPool> weakPool(shared_from_this());
+        return BufferPtr(buffer, [weakPool](Buffer* b) {
+                std::shared_ptr<BufferPool> pool = weakPool.lock();
+                if (pool)
+                    pool->release(b);
+                else
+                    delete b;
+            });
+    }
+    try {
+        return std::make_shared<Buffer>(size);
+    } catch (std::bad_alloc&) {
+        throw OutOfMemoryError("Buffer allocation failed : out of memory?");
+    }
+}
+
+void BufferPool::release(Buffer* buffer)
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (buffer->ownsData() &&
+            mStats.pooledBytes + buffer->capacity() <= mMaxPooledBytes) {
+            buffer->reset();
+            mFree[sizeClass(buffer->capacity())].push_back(buffer);
+            mStats.pooledBytes += buffer->capacity();
+            return;
+        }
+        mStats.discarded++;
+    }
+    delete buffer;
+}
+
+void BufferPool::trim()
+{
+    std::vector<std::vector<Buffer*>> toFree(mFree.size());
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        toFree.swap(mFree);
+        mStats.pooledBytes = 0;
+    }
+    for (std::vector<Buffer*>& freeList : toFree) {
+        for (Buffer* buffer : freeList)
+            delete buffer;
+    }
+}
+
+BufferPool::Stats BufferPool::stats() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mStats;
+}
+
+}
+}
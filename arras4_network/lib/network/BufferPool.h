@@ -0,0 +1,85 @@
+// Copyright 2023-2024 DreamWorks Animation LLC and Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __ARRAS4_BUFFER_POOLH__
+#define __ARRAS4_BUFFER_POOLH__
+
+#include "network_types.h"
+
+#include <mutex>
+#include <vector>
+
+namespace arras4 {
+    namespace network {
+
+// BufferPool keeps released Buffers for reuse, so that receiving a
+// steady stream of messages doesn't allocate (and page fault) a fresh
+// buffer for every frame.
+//
+// Buffers are grouped into power-of-2 size classes. acquire() returns
+// a BufferPtr whose deleter hands the buffer back to the pool, so a
+// buffer that has been taken from a source (e.g. by OpaqueContent)
+// returns to the pool when the last reference to it goes away, on
+// whichever thread that happens. If the pool itself has been destroyed
+// by then, the buffer is simply deleted.
+//
+// Requests larger than the maximum pooled size are allocated and
+// freed normally, as are buffers that would take the total pooled
+// memory above the limit.
+class BufferPool : public std::enable_shared_from_this<BufferPool>
+{
+public:
+    // smallest size class (4kb)
+    static constexpr size_t MIN_POOLED_SIZE = 4*1024;
+    // default largest size class (64Mb)
+    static constexpr size_t DEFAULT_MAX_POOLED_SIZE = 64*1024*1024;
+    // default limit on memory held by free buffers (256Mb)
+    static constexpr size_t DEFAULT_MAX_POOLED_BYTES = 256*1024*1024;
+
+    struct Stats {
+        size_t hits = 0;        // acquire() satisfied from the pool
+        size_t misses = 0;      // acquire() allocated a new buffer
+        size_t unpooled = 0;    // acquire() too large to pool
+        size_t discarded = 0;   // released buffers freed due to the limit
+        size_t pooledBytes = 0; // memory currently held by free buffers
+    };
+
+    // pools must be held by shared_ptr, so that outstanding
+    // buffers can detect when the pool has gone
+    static std::shared_ptr<BufferPool> create(size_t maxPooledSize = DEFAULT_MAX_POOLED_SIZE,
+                                              size_t maxPooledBytes = DEFAULT_MAX_POOLED_BYTES);
+
+    // process-wide pool used by BufferedSource by default
+    static const std::shared_ptr<BufferPool>& defaultPool();
+
+    ~BufferPool();
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    // returns an empty buffer with capacity at least 'size'.
+    // throws OutOfMemoryError if allocation fails
+    BufferPtr acquire(size_t size);
+
+    // free all buffers currently held by the pool
+    void trim();
+
+    Stats stats() const;
+
+private:
+    BufferPool(size_t maxPooledSize, size_t maxPooledBytes);
+    static size_t sizeClass(size_t size);
+    void release(Buffer* buffer);
+
+    const size_t mMaxPooledSize;
+    const size_t mMaxPooledBytes;
+
+    mutable std::mutex mMutex;
+    // free buffers, indexed by size class
+    std::vector<std::vector<Buffer*>> mFree;
+    Stats mStats;
+};
+
+}
+}
+#endif
@@ -16,12 +16,23 @@
 // One contiguous buffer would require complete reallocation and copying every
 // time it needed to grow. There is no reason that the data has to be stored
 // in one block, so instead we use a MultiBuffer
+//
+// The MultiBuffer starts small, so that small messages don't cost a large
+// allocation, and uses the pooled allocator. After each frame, capacity
+// over RETAINED_CAPACITY is handed back to the pool, so that one large
+// message doesn't tie up memory in every sink that has sent one.
+namespace {
+    const size_t RETAINED_CAPACITY = arras4::network::INITIAL_BUFFER_SIZE;
+}
+
 namespace arras4 {
     namespace network {
 
 
 BufferedSink::BufferedSink(FramedSink& outputSink)
     :  mOutputSink(outputSink),
+       mMultiBuffer(SMALL_INITIAL_BUFFER_SIZE, LINEAR_BUFFER_SIZE,
+                    MultiBufferAllocator::pooled()),
        mAppendedLength(0)
 {
 }
@@ -51,22 +62,26 @@ bool BufferedSink::openFrame()
 
 bool BufferedSink::closeFrame()
 {
-    // now the frame is ended, we can send it to our output sink
-    bool ok = mOutputSink.openFrame(bytesWritten());
-    if (!ok) return false; // timeout
-
+    // now the frame is ended, we can send it to our output sink.
+    // The multibuffer segments and appended buffers are gathered 
+    // into a single list so that the output can send the whole 
+    // frame in as few operations as possible
+    mSegments.clear();
     for (size_t i = 0; i < mMultiBuffer.bufferCount(); i++) {
         const BufferUniquePtr& buf = mMultiBuffer.buffer(i);
-        mOutputSink.write(buf->start(),buf->remaining());
+        mSegments.push_back({ buf->start(), buf->remaining() });
     }                    
         
     for (size_t i = 0; i < mAppendedBuffers.size(); i++) {
         const BufferConstPtr& buf = mAppendedBuffers[i];
-        mOutputSink.write(buf->start(),buf->remaining());
+        mSegments.push_back({ buf->start(), buf->remaining() });
     }
-                    
-    mOutputSink.closeFrame();
+
+    bool ok = mOutputSink.writeFrame(mSegments.data(), mSegments.size());
+    if (!ok) return false; // timeout
+
     reset();
+    mMultiBuffer.shrinkTo(RETAINED_CAPACITY);
     return true;
 }
     
@@ -47,6 +47,8 @@ public:
     size_t write(const unsigned char* aBuf, size_t aLen);
     void flush();
     size_t bytesWritten() const { return mMultiBuffer.bytesWritten() + mAppendedLength; }
+    unsigned char* writeWindow(size_t& aAvailable) { return mMultiBuffer.writeWindow(aAvailable); }
+    void commitWrite(size_t aLength) { mMultiBuffer.commitWrite(aLength); }
 
     // provides an autoframed sink, with each frame being a
     // complete message.
@@ -57,6 +59,9 @@ public:
     // buffer to the frame : used for efficient transfer 
     // of opaque messages
     void appendBuffer(const BufferConstPtr& buf);
+
+    // allocate buffer space for 'aLength' more bytes
+    void reserve(size_t aLength) { mMultiBuffer.reserve(aLength); }
      
     // shrink buffer capacity to less than or equal to
     // 'maxCapacity' by removing buffers. Will not
@@ -76,6 +81,9 @@ private:
     // additional appended buffers
     size_t mAppendedLength;
     std::vector<BufferConstPtr> mAppendedBuffers;
+
+    // segment list used to send a frame, kept to avoid reallocation
+    std::vector<DataSegment> mSegments;
 };
 
 }
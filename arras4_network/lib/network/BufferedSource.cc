@@ -4,7 +4,6 @@
 #include "BufferedSource.h"
 #include "Buffer.h"
 #include "FramingError.h"
-#include "OutOfMemoryError.h"
 
 #include <fstream>
 
@@ -12,8 +11,10 @@ namespace arras4 {
     namespace network {
 
 
-BufferedSource::BufferedSource(FramedSource& inputSource) :
-    mInputSource(inputSource)
+BufferedSource::BufferedSource(FramedSource& inputSource,
+                               const std::shared_ptr<BufferPool>& pool) :
+    mInputSource(inputSource),
+    mPool(pool)
 {
 }
 
@@ -47,6 +48,21 @@ size_t BufferedSource::read(unsigned char* aBuf, size_t aLen)
     return aLen;
 }
 
+const unsigned char* BufferedSource::readWindow(size_t& aAvailable)
+{
+    if (!mBuffer) {
+        aAvailable = 0;
+        return nullptr;
+    }
+    return mBuffer->readWindow(aAvailable);
+}
+
+void BufferedSource::commitRead(size_t aLength)
+{
+    if (mBuffer)
+        mBuffer->commitRead(aLength);
+}
+
 size_t BufferedSource::skip(size_t aLen)
 { 
     if (!mBuffer)
@@ -63,11 +79,9 @@ size_t BufferedSource::skip(size_t aLen)
 unsigned char* BufferedSource::prepForFill(size_t size)
 {
     if (!mBuffer || size > mBuffer->capacity()) {
-        try {
-            mBuffer = BufferPtr(new Buffer(size));
-        } catch (std::bad_alloc&) {
-            throw OutOfMemoryError("Read buffer allocation failed : out of memory?");
-        }
+        // release the old buffer to the pool first, so it can be reused
+        mBuffer.reset();
+        mBuffer = mPool->acquire(size);
     }
     mBuffer->reset();
     unsigned char* fillAddr;
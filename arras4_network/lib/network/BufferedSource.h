@@ -6,6 +6,7 @@
 
 #include "network_types.h"
 #include "DataSource.h"
+#include "BufferPool.h"
 
 namespace arras4 {
     namespace network {
@@ -21,6 +22,9 @@ namespace arras4 {
 // opaque data from the source to a sink without additional
 // copying. See also BufferedSink::appendBuffer().
 //
+// Frame buffers come from a BufferPool, and go back to it when they
+// are replaced or when the last reference to a taken buffer is dropped.
+//
 // BufferedSource supports timeouts in the input source, 
 // i.e. if inputSource.nextFrame() returns 0, then 
 // BS::nextFrame will return 0 and can be called again.
@@ -28,7 +32,8 @@ namespace arras4 {
 class BufferedSource : public DetachableBufferSource
 {
 public:
-    BufferedSource(FramedSource& inputSource);
+    BufferedSource(FramedSource& inputSource,
+                   const std::shared_ptr<BufferPool>& pool = BufferPool::defaultPool());
     ~BufferedSource();
 
     BufferedSource(const BufferedSource&) = delete;
@@ -41,6 +46,8 @@ public:
     size_t read(unsigned char* aBuf, size_t aLen);
     size_t skip(size_t aLen);
     size_t bytesRead() const;
+    const unsigned char* readWindow(size_t& aAvailable);
+    void commitRead(size_t aLength);
 
     // BufferedSource supports framing : each frame is one message
     size_t nextFrame();
@@ -64,6 +71,7 @@ private:
     void newBuffer(size_t size);
 
     FramedSource& mInputSource;
+    std::shared_ptr<BufferPool> mPool;
     bool mIsInFrame = false;
 
     BufferPtr mBuffer;
@@ -12,6 +12,14 @@ namespace arras4
 {
     namespace network {
 
+// describes one contiguous block of data in a 
+// scatter-gather write
+struct DataSegment
+{
+    const unsigned char* data;
+    size_t length;
+};
+
 // a sink that can receive blocks of data
 class DataSink
 {
@@ -23,6 +31,32 @@ public:
     virtual void flush() = 0;
     virtual size_t bytesWritten() const=0;
 
+    // write out a sequence of blocks, in order. Sinks that 
+    // can transfer several blocks in one operation (e.g. 
+    // a socket using writev) override this : the default 
+    // simply writes each block in turn. Returns total number of
+    // bytes written, or 0 on timeout.
+    virtual size_t writeSegments(const DataSegment* aSegments, size_t aCount) {
+        size_t total = 0;
+        for (size_t i = 0; i < aCount; i++) {
+            size_t w = write(aSegments[i].data, aSegments[i].length);
+            if (w == 0 && aSegments[i].length != 0) return 0;
+            total += w;
+        }
+        return total;
+    }
+
+    // direct access to free space at the current write position, so
+    // that a writer can copy small items in without a virtual call
+    // per item. Returns a pointer to the space and sets 'aAvailable' to
+    // its size, or returns null if the sink doesn't support this. Data
+    // placed in the space is only written once commitWrite() is called,
+    // which must happen before any other call on the sink.
+    virtual unsigned char* writeWindow(size_t& aAvailable) {
+        aAvailable = 0;
+        return nullptr;
+    }
+    virtual void commitWrite(size_t /*aLength*/) {}
 };
 
 // a sink that delivers data within a framing protocol.
@@ -48,6 +82,21 @@ public:
     // occurs before the frame can be closed, and may then be called
     // again.
     virtual bool closeFrame()=0;
+
+    // write a complete frame made up of a sequence of blocks.
+    // Equivalent to openFrame(total length), write() of each block and
+    // closeFrame(), but allows the implementation to pass the frame
+    // header and data to the output in a single operation. Returns false 
+    // if a timeout occurs before the frame can be opened.
+    virtual bool writeFrame(const DataSegment* aSegments, size_t aCount) {
+        size_t frameSize = 0;
+        for (size_t i = 0; i < aCount; i++)
+            frameSize += aSegments[i].length;
+        if (!openFrame(frameSize)) return false;
+        for (size_t i = 0; i < aCount; i++)
+            write(aSegments[i].data, aSegments[i].length);
+        return closeFrame();
+    }
 };
 
 // Similar to a framed sink, but it is not necessary to specify
@@ -74,6 +123,10 @@ public:
 
     virtual void appendBuffer(const BufferConstPtr& buf)=0;
 
+    // hint that 'aLength' more bytes are about to be written to the
+    // current frame, so that buffer space can be allocated in one go
+    virtual void reserve(size_t /*aLength*/) {}
+
     // writes all buffers to file. Returns false if write fails.
     virtual bool writeToFile(const std::string& filepath)=0;  
 };
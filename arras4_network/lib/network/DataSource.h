@@ -27,6 +27,18 @@ public:
     // return count bytes consumed
     virtual size_t bytesRead() const = 0;
 
+    // direct access to unread data at the current read position, so
+    // that a reader can copy small items out without a virtual call
+    // per item. Returns a pointer to the data and sets 'aAvailable'
+    // to its size, or returns null if the source doesn't support this.
+    // Data is only consumed once commitRead() is called, which must
+    // happen before any other call on the source.
+    virtual const unsigned char* readWindow(size_t& aAvailable) {
+        aAvailable = 0;
+        return nullptr;
+    }
+    virtual void commitRead(size_t /*aLength*/) {}
+
 };
 
 // a source that delivers data within a framing protocol.
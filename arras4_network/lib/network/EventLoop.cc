@@ -0,0 +1,200 @@
+// Copyright 2023-2024 DreamWorks Animation LLC and Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "EventLoop.h"
+#include "SocketPeer.h"
+#include "PeerException.h"
+#include "InvalidParameterError.h"
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <errno.h>
+#include <string.h>
+#include <vector>
+
+namespace {
+    // maximum number of events fetched per epoll_wait
+    const int MAX_EVENTS = 64;
+
+    // the registration whose callback is running on this thread,
+    // if any
+    thread_local const void* tDispatching = nullptr;
+}
+
+namespace arras4 {
+    namespace network {
+
+EventLoop::EventLoop() :
+    mEpollFd(-1),
+    mWakeFd(-1),
+    mStopped(false)
+{
+    mEpollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (mEpollFd < 0) {
+        int save_errno = errno;
+        throw PeerException(save_errno, std::string("EventLoop: epoll_create1 failed: ") + strerror(save_errno));
+    }
+    mWakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (mWakeFd < 0) {
+        int save_errno = errno;
+        close(mEpollFd);
+        throw PeerException(save_errno, std::string("EventLoop: eventfd failed: ") + strerror(save_errno));
+    }
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = mWakeFd;
+    if (epoll_ctl(mEpollFd, EPOLL_CTL_ADD, mWakeFd, &ev) < 0) {
+        int save_errno = errno;
+        close(mWakeFd);
+        close(mEpollFd);
+        throw PeerException(save_errno, std::string("EventLoop: epoll_ctl failed: ") + strerror(save_errno));
+    }
+}
+
+EventLoop::~EventLoop()
+{
+    close(mWakeFd);
+    close(mEpollFd);
+}
+
+void EventLoop::addPeer(SocketPeer& peer, unsigned events, Callback callback)
+{
+    int fd = peer.fd();
+    if (fd == ARRAS_INVALID_SOCKET)
+        throw InvalidParameterError("EventLoop::addPeer on an unconnected peer");
+    if (!callback)
+        throw InvalidParameterError("EventLoop::addPeer requires a callback");
+
+    peer.setNonBlocking(true);
+
+    RegistrationPtr reg = std::make_shared<Registration>();
+    reg->peer = &peer;
+    reg->callback = callback;
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLET | EPOLLRDHUP;
+    if (events & READABLE) ev.events |= EPOLLIN;
+    if (events & WRITABLE) ev.events |= EPOLLOUT;
+    ev.data.fd = fd;
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (epoll_ctl(mEpollFd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        int save_errno = errno;
+        throw PeerException(save_errno, std::string("EventLoop::addPeer: ") + strerror(save_errno));
+    }
+    mRegistrations[fd] = reg;
+}
+
+void EventLoop::removePeer(SocketPeer& peer)
+{
+    int fd = peer.fd();
+    RegistrationPtr reg;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto it = mRegistrations.find(fd);
+        if (it == mRegistrations.end() || it->second->peer != &peer)
+            return;
+        // clearing the peer pointer stops any pending dispatch
+        // of events that were fetched before the removal
+        reg = it->second;
+        reg->peer = nullptr;
+        mRegistrations.erase(it);
+        epoll_ctl(mEpollFd, EPOLL_CTL_DEL, fd, nullptr);
+    }
+    // wait for a callback that is already running, unless it is
+    // the one calling us
+    if (reg.get() != tDispatching) {
+        std::lock_guard<std::mutex> dispatchLock(reg->dispatchMutex);
+    }
+}
+
+size_t EventLoop::peerCount() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mRegistrations.size();
+}
+
+int EventLoop::runOnce(int timeoutMs)
+{
+    struct epoll_event events[MAX_EVENTS];
+    int count;
+    do {
+        count = epoll_wait(mEpollFd, events, MAX_EVENTS, timeoutMs);
+    } while (count < 0 && errno == EINTR);
+
+    if (count < 0) {
+        int save_errno = errno;
+        throw PeerException(save_errno, std::string("EventLoop::runOnce: ") + strerror(save_errno));
+    }
+
+    // look up all registrations before dispatching any, so that
+    // callbacks are free to add and remove peers
+    std::vector<std::pair<RegistrationPtr, unsigned>> ready;
+    ready.reserve(count);
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (int i = 0; i < count; i++) {
+            int fd = events[i].data.fd;
+            if (fd == mWakeFd) {
+                uint64_t value;
+                while (read(mWakeFd, &value, sizeof(value)) > 0) {}
+                continue;
+            }
+            auto it = mRegistrations.find(fd);
+            if (it == mRegistrations.end())
+                continue;
+            unsigned flags = 0;
+            if (events[i].events & EPOLLIN) flags |= READABLE;
+            if (events[i].events & EPOLLOUT) flags |= WRITABLE;
+            if (events[i].events & (EPOLLHUP | EPOLLRDHUP | EPOLLERR)) flags |= HANGUP;
+            ready.emplace_back(it->second, flags);
+        }
+    }
+
+    int dispatched = 0;
+    for (auto& r : ready) {
+        // removePeer clears the peer before it waits on dispatchMutex,
+        // so the check and the call can't straddle a removal
+        std::lock_guard<std::mutex> dispatchLock(r.first->dispatchMutex);
+        if (r.first->peer == nullptr)
+            continue; // removed by an earlier callback or another thread
+        tDispatching = r.first.get();
+        try {
+            r.first->callback(r.second);
+        } catch (...) {
+            tDispatching = nullptr;
+            throw;
+        }
+        tDispatching = nullptr;
+        dispatched++;
+    }
+    return dispatched;
+}
+
+void EventLoop::run()
+{
+    while (!mStopped) {
+        runOnce(-1);
+    }
+    mStopped = false;
+}
+
+void EventLoop::stop()
+{
+    mStopped = true;
+    wakeup();
+}
+
+void EventLoop::wakeup()
+{
+    uint64_t one = 1;
+    ssize_t w = write(mWakeFd, &one, sizeof(one));
+    (void)w;
+}
+
+}
+}
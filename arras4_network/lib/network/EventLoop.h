@@ -0,0 +1,103 @@
+// Copyright 2023-2024 DreamWorks Animation LLC and Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __ARRAS4_EVENT_LOOPH__
+#define __ARRAS4_EVENT_LOOPH__
+
+#include "network_types.h"
+#include "network_platform.h"
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace arras4 {
+    namespace network {
+
+// EventLoop multiplexes many non-blocking socket peers onto
+// a single thread, using edge-triggered epoll (Linux only).
+//
+// A peer is registered with a callback, which is invoked from
+// the thread running the loop whenever the socket becomes readable
+// and/or writable. Because notification is edge-triggered, the callback
+// must consume all available input (until receive_nonblocking returns 0)
+// and send until the socket buffer is full or there is nothing more to
+// send : it will not be called again until the state changes.
+// NonBlockingFramingSource and NonBlockingFramingSink implement this
+// for the Arras BasicFraming protocol.
+//
+// To use more than one thread, create one EventLoop per thread and
+// distribute peers between them. addPeer, removePeer and stop may be
+// called from any thread : see removePeer for how it interacts with
+// a callback that is running.
+class EventLoop
+{
+public:
+    enum Events {
+        READABLE = 1,
+        WRITABLE = 2,
+        HANGUP = 4
+    };
+
+    // callback receives a combination of Events flags
+    typedef std::function<void(unsigned events)> Callback;
+
+    // throws PeerException if epoll is not available
+    EventLoop();
+    ~EventLoop();
+
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+
+    // register a peer. The peer is switched to non-blocking mode and
+    // must remain valid until it is removed. 'events' selects READABLE
+    // and/or WRITABLE notification.
+    void addPeer(SocketPeer& peer, unsigned events, Callback callback);
+
+    // unregister a peer. Once this returns, the peer's callback is not
+    // running and will not be called again, so the peer may be destroyed.
+    // If the callback is running on the loop thread, removePeer waits for
+    // it to finish, so the caller must not hold anything the callback
+    // needs. The exception is a callback removing its own peer, which
+    // doesn't wait : the peer must then stay valid until the callback
+    // returns.
+    void removePeer(SocketPeer& peer);
+
+    // wait for events for up to timeoutMs (-1 to wait indefinitely)
+    // and dispatch them. Returns the number of callbacks invoked.
+    int runOnce(int timeoutMs);
+
+    // dispatch events until stop() is called
+    void run();
+
+    // cause run() to return. Safe to call from any thread,
+    // including from a callback
+    void stop();
+
+    size_t peerCount() const;
+
+private:
+    void wakeup();
+
+    struct Registration {
+        std::atomic<SocketPeer*> peer;
+        Callback callback;
+        // held while the callback runs, so that removePeer can wait
+        // for it
+        std::mutex dispatchMutex;
+    };
+    typedef std::shared_ptr<Registration> RegistrationPtr;
+
+    int mEpollFd;
+    int mWakeFd;
+    std::atomic<bool> mStopped;
+
+    mutable std::mutex mMutex;
+    std::map<int, RegistrationPtr> mRegistrations;
+};
+
+}
+}
+#endif
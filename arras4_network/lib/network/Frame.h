@@ -4,6 +4,9 @@
 #ifndef __ARRAS4_FRAMEH__
 #define __ARRAS4_FRAMEH__
 
+#include <cstdint>
+#include <limits>
+
 // definition of the header for arras BasicFraming
 namespace arras4 {
     namespace network {
@@ -17,15 +20,49 @@ public:
         FRAME_UTF8,
         FRAME_UNKNOWN,
     };
+
+    // Header versions. VERSION_BASIC is the original header, with a 32-bit
+    // length and zeroed reserved fields. VERSION_LARGE reuses the first reserved
+    // field for the high 32 bits of the length, and marks the second with 
+    // the version. Since the reserved fields were always written as zero, 
+    // any reader that understands VERSION_LARGE also reads basic headers.
+    // Writers only use VERSION_LARGE for frames that don't fit in 32 bits,
+    // and only when the reader has advertised support for it.
+    static constexpr unsigned VERSION_BASIC = 0;
+    static constexpr unsigned VERSION_LARGE = 1;
+    static constexpr unsigned VERSION_CURRENT = VERSION_LARGE;
+
     // whether this frame is binary or text (UTF-8)
     FrameType mType = FRAME_UNKNOWN;
 
-    // length of this frame in bytes
+    // length of this frame in bytes (low 32 bits for VERSION_LARGE)
     unsigned int mLength = 0;
 
-    // reserved
-    unsigned int mReserved1 = 0;
-    unsigned int mReserved2 = 0;
+    // high 32 bits of length for VERSION_LARGE, otherwise reserved (0)
+    unsigned int mLengthHigh = 0;
+
+    // header version
+    unsigned int mVersion = VERSION_BASIC;
+
+    // maximum frame length that can be written with the given header version
+    static uint64_t maxLength(unsigned version) {
+        if (version >= VERSION_LARGE)
+            return std::numeric_limits<uint64_t>::max();
+        return std::numeric_limits<unsigned int>::max();
+    }
+
+    // set the length, using the oldest header version that can represent it
+    void setLength(uint64_t length) {
+        mLength = static_cast<unsigned int>(length);
+        mLengthHigh = static_cast<unsigned int>(length >> 32);
+        mVersion = mLengthHigh ? VERSION_LARGE : VERSION_BASIC;
+    }
+
+    uint64_t length() const {
+        if (mVersion >= VERSION_LARGE)
+            return (static_cast<uint64_t>(mLengthHigh) << 32) | mLength;
+        return mLength;
+    }
 };
 
 }
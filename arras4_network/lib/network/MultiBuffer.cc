@@ -3,7 +3,6 @@
 
 #include "MultiBuffer.h"
 #include "Buffer.h"
-#include "OutOfMemoryError.h"
 
 #include <algorithm>
 
@@ -12,8 +11,10 @@ namespace arras4 {
 
 
 MultiBuffer::MultiBuffer(size_t initialSize,
-                         size_t linearSize)
-    :  mInitialSize(initialSize),
+                         size_t linearSize,
+                         MultiBufferAllocator& allocator)
+    :  mAllocator(&allocator),
+       mInitialSize(initialSize),
        mLinearSize(linearSize),
        mBytesWritten(0),
        mReadBuffer(0),
@@ -25,6 +26,28 @@ MultiBuffer::MultiBuffer(size_t initialSize,
 
 MultiBuffer::~MultiBuffer()
 {
+    releaseBuffers(0);
+}
+
+// remove buffers from 'first' onwards, returning
+// them to the allocator
+void MultiBuffer::releaseBuffers(size_t first)
+{
+    for (size_t i = first; i < mBuffers.size(); i++) {
+        if (mFromAllocator[i])
+            mAllocator->release(std::move(mBuffers[i]));
+    }
+    mBuffers.resize(first);
+    mFromAllocator.resize(first);
+}
+
+BufferUniquePtr MultiBuffer::takeBuffer(size_t index)
+{
+    BufferUniquePtr buf(std::move(mBuffers[index]));
+    if (buf && mFromAllocator[index])
+        mAllocator->detach(*buf);
+    mFromAllocator[index] = false;
+    return buf;
 }
 
 size_t MultiBuffer::nextSize(size_t size)
@@ -87,6 +110,42 @@ size_t MultiBuffer::skip(size_t aLen)
     return skipped;
 }
 
+unsigned char* MultiBuffer::writeWindow(size_t& aAvailable)
+{
+    if (mUsedBuffers == 0 ||
+        mBuffers[mUsedBuffers-1]->remainingCapacity() == 0) {
+        useNextBuffer();
+    }
+    return mBuffers[mUsedBuffers-1]->writeWindow(aAvailable);
+}
+
+void MultiBuffer::commitWrite(size_t aLength)
+{
+    if (mUsedBuffers == 0) return;
+    Buffer* buf = mBuffers[mUsedBuffers-1].get();
+    size_t before = buf->bytesWritten();
+    buf->commitWrite(aLength);
+    mBytesWritten += buf->bytesWritten() - before;
+}
+
+const unsigned char* MultiBuffer::readWindow(size_t& aAvailable)
+{
+    while (mReadBuffer < mUsedBuffers) {
+        Buffer* buf = mBuffers[mReadBuffer].get();
+        if (buf->remaining() > 0)
+            return buf->readWindow(aAvailable);
+        mReadBuffer++;
+    }
+    aAvailable = 0;
+    return nullptr;
+}
+
+void MultiBuffer::commitRead(size_t aLength)
+{
+    if (mReadBuffer < mUsedBuffers)
+        mBytesRead += mBuffers[mReadBuffer]->skip(aLength);
+}
+
 void MultiBuffer::collect(Buffer& out)
 {
     for (size_t i = 0; i < mUsedBuffers; i++) {
@@ -122,10 +181,27 @@ size_t MultiBuffer::write(const unsigned char* aBuf, size_t aLen)
     return aLen;
 }
 
+void MultiBuffer::reserve(size_t aLength)
+{
+    size_t available = 0;
+    if (mUsedBuffers > 0)
+        available = mBuffers[mUsedBuffers-1]->remainingCapacity();
+    for (size_t i = mUsedBuffers; i < mBuffers.size() && available < aLength; i++)
+        available += mBuffers[i]->capacity();
+    if (available >= aLength)
+        return;
+
+    // new buffer goes after all the existing ones, and
+    // will be used once they are full
+    mBuffers.push_back(mAllocator->allocate(std::max(aLength - available, mInitialSize)));
+    mFromAllocator.push_back(true);
+}
+
 bool MultiBuffer::addBuffer(BufferUniquePtr&& buf)
 {
     if (mUsedBuffers == mBuffers.size()) {
         mBuffers.push_back(std::move(buf));
+        mFromAllocator.push_back(false);
         mUsedBuffers++;
         return true;
     }
@@ -141,12 +217,8 @@ void MultiBuffer::useNextBuffer()
         size_t newSize = mInitialSize;
         if (nextBuffer > 0)
             newSize = nextSize(mBuffers[nextBuffer-1]->capacity());
-        try {
-            Buffer* newBuffer = new Buffer(newSize);
-            mBuffers.push_back(BufferUniquePtr(newBuffer));
-        } catch (std::bad_alloc&) {
-            throw OutOfMemoryError("Write buffer allocation failed : out of memory?");
-        }
+        mBuffers.push_back(mAllocator->allocate(newSize));
+        mFromAllocator.push_back(true);
     } else {
         mBuffers[nextBuffer]->reset();
     }
@@ -174,7 +246,7 @@ void MultiBuffer::shrinkTo(size_t maxCapacity)
     // we can only remove unused buffers
     target = std::max(target,mUsedBuffers);
     if (target < mBuffers.size()) {
-        mBuffers.resize(target);
+        releaseBuffers(target);
     }
 }
 
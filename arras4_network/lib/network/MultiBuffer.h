@@ -8,6 +8,7 @@
 
 #include "DataSource.h"
 #include "DataSink.h"
+#include "MultiBufferAllocator.h"
 
 #include <vector>
 
@@ -15,6 +16,8 @@ namespace arras4 {
     namespace network {
 // size of initial buffer allocation (1Mb)
 constexpr size_t INITIAL_BUFFER_SIZE = 1024*1024;
+// initial allocation for buffers that mostly hold small messages (4kb)
+constexpr size_t SMALL_INITIAL_BUFFER_SIZE = 4*1024;
 // size at which new buffer allocation becomes linear (1Gb)
 constexpr size_t LINEAR_BUFFER_SIZE = 1024*1024*1024;
 
@@ -26,13 +29,19 @@ constexpr size_t LINEAR_BUFFER_SIZE = 1024*1024*1024;
 // until 'linearSize' is reached. After this, each new buffer is always
 // 'linearSize'.
 //
+// Buffers are obtained from 'allocator' and returned to it when they are
+// removed. The default pooled allocator may round buffer sizes up to a
+// power of two : use MultiBufferAllocator::heap() if the exact sizes
+// matter.
+//
 // To access the written data, you can either use read(), iterate through the buffers, via
 // bufferCount()/buffer(i) or copy the data into a single buffer via 'collect'.
 class MultiBuffer : public DataSource, public DataSink
 {
 public:
     MultiBuffer(size_t initialSize=INITIAL_BUFFER_SIZE,
-                size_t linearSize=LINEAR_BUFFER_SIZE);
+                size_t linearSize=LINEAR_BUFFER_SIZE,
+                MultiBufferAllocator& allocator=MultiBufferAllocator::pooled());
 
     ~MultiBuffer();
 
@@ -49,6 +58,14 @@ public:
     void flush() {}
     size_t bytesRead() const { return mBytesRead; }
 
+    // the write window is the free space in the current buffer,
+    // moving to a new buffer if that is full. The read window is
+    // the unread data in the current buffer.
+    unsigned char* writeWindow(size_t& aAvailable);
+    void commitWrite(size_t aLength);
+    const unsigned char* readWindow(size_t& aAvailable);
+    void commitRead(size_t aLength);
+
     // collect the data into 'out', stopping when out
     // runs out of capacity
     void collect(Buffer& out);
@@ -56,6 +73,12 @@ public:
     // reset the write pointer, without deallocating buffers
     void reset();
 
+    // make sure there is buffer space for 'aLength' more bytes,
+    // adding a single buffer for the shortfall if there isn't.
+    // Used when the amount of data is known in advance, to avoid
+    // allocating a series of doubling buffers
+    void reserve(size_t aLength);
+
     // add a buffer. This fails and returns false if
     // the current last buffer is not in use. Generally
     // you would add buffers just after construction
@@ -70,11 +93,15 @@ public:
     
     size_t bufferCount() { return mUsedBuffers; }
     const BufferUniquePtr& buffer(size_t index) { return mBuffers[index]; }
-    BufferUniquePtr&& takeBuffer(size_t index) { return std::move(mBuffers[index]); }
+    // removes a buffer, leaving a null entry. The caller takes ownership
+    BufferUniquePtr takeBuffer(size_t index);
 
 private:
     void useNextBuffer();
     size_t nextSize(size_t size);
+    void releaseBuffers(size_t first);
+
+    MultiBufferAllocator* mAllocator;
 
     // initial size of buffer to allocate
     size_t mInitialSize;
@@ -93,6 +120,9 @@ private:
     size_t mUsedBuffers;
    
     std::vector<BufferUniquePtr> mBuffers;
+
+    // true for buffers that came from mAllocator, rather than addBuffer()
+    std::vector<bool> mFromAllocator;
 };
 
 }
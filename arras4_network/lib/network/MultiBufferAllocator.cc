@@ -0,0 +1,267 @@
+// Copyright 2023-2024 DreamWorks Animation LLC and Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "MultiBufferAllocator.h"
+#include "Buffer.h"
+#include "OutOfMemoryError.h"
+
+#include <mutex>
+#include <vector>
+
+namespace {
+
+using arras4::network::Buffer;
+
+// smallest segment size used by the pooled allocator (4kb)
+constexpr size_t MIN_SEGMENT_SIZE = 4*1024;
+// size classes cached per thread : 4kb to 512kb
+constexpr size_t SMALL_CLASSES = 8;
+// size classes cached in the shared pool : 1Mb to 64Mb
+constexpr size_t LARGE_CLASSES = 7;
+constexpr size_t MAX_POOLED_SIZE = MIN_SEGMENT_SIZE << (SMALL_CLASSES + LARGE_CLASSES - 1);
+// limits on the memory held by free segments
+constexpr size_t THREAD_CACHE_BYTES = 4*1024*1024;
+constexpr size_t SHARED_CACHE_BYTES = 256*1024*1024;
+
+size_t sizeClass(size_t size)
+{
+    size_t index = 0;
+    size_t classSize = MIN_SEGMENT_SIZE;
+    while (classSize < size) {
+        classSize <<= 1;
+        index++;
+    }
+    return index;
+}
+
+size_t classSize(size_t index)
+{
+    return MIN_SEGMENT_SIZE << index;
+}
+
+Buffer* newSegment(size_t size)
+{
+    try {
+        return new Buffer(size);
+    } catch (std::bad_alloc&) {
+        throw arras4::network::OutOfMemoryError("Write buffer allocation failed : out of memory?");
+    }
+}
+
+} // namespace
+
+namespace arras4 {
+    namespace network {
+
+void MultiBufferAllocator::allocated(size_t bytes)
+{
+    size_t resident = mResidentBytes.fetch_add(bytes) + bytes;
+    size_t peak = mPeakResidentBytes.load();
+    while (resident > peak &&
+           !mPeakResidentBytes.compare_exchange_weak(peak, resident));
+    mInUseBytes += bytes;
+    mAllocations++;
+}
+
+void MultiBufferAllocator::reused(size_t bytes)
+{
+    mInUseBytes += bytes;
+    mReuses++;
+}
+
+void MultiBufferAllocator::cached(size_t bytes)
+{
+    mInUseBytes -= bytes;
+}
+
+void MultiBufferAllocator::freed(size_t bytes, bool inUse)
+{
+    mResidentBytes -= bytes;
+    if (inUse)
+        mInUseBytes -= bytes;
+}
+
+void MultiBufferAllocator::detach(const Buffer& segment)
+{
+    freed(segment.capacity(), true);
+}
+
+MultiBufferAllocator::Stats MultiBufferAllocator::stats() const
+{
+    Stats s;
+    s.residentBytes = mResidentBytes;
+    s.peakResidentBytes = mPeakResidentBytes;
+    s.inUseBytes = mInUseBytes;
+    s.allocations = mAllocations;
+    s.reuses = mReuses;
+    return s;
+}
+
+namespace {
+
+class HeapAllocator : public MultiBufferAllocator
+{
+public:
+    BufferUniquePtr allocate(size_t size)
+    {
+        BufferUniquePtr segment(newSegment(size));
+        allocated(size);
+        return segment;
+    }
+
+    void release(BufferUniquePtr&& segment)
+    {
+        if (segment && segment->ownsData())
+            freed(segment->capacity(), true);
+        segment.reset();
+    }
+};
+
+class PooledAllocator : public MultiBufferAllocator
+{
+public:
+    PooledAllocator() : mShared(LARGE_CLASSES) {}
+
+    ~PooledAllocator()
+    {
+        for (std::vector<Buffer*>& freeList : mShared) {
+            for (Buffer* segment : freeList)
+                delete segment;
+        }
+    }
+
+    BufferUniquePtr allocate(size_t size);
+    void release(BufferUniquePtr&& segment);
+
+    // per thread cache of small segments
+    struct ThreadCache {
+        std::vector<Buffer*> mFree[SMALL_CLASSES];
+        size_t mBytes = 0;
+        ~ThreadCache();
+    };
+
+private:
+    static ThreadCache* threadCache();
+
+    std::mutex mSharedMutex;
+    std::vector<std::vector<Buffer*>> mShared;
+    size_t mSharedBytes = 0;
+};
+
+PooledAllocator& thePooledAllocator()
+{
+    static PooledAllocator allocator;
+    return allocator;
+}
+
+// set when this thread's cache has been destroyed, so that
+// segments released during thread exit are simply freed
+thread_local bool tCacheDestroyed = false;
+
+PooledAllocator::ThreadCache::~ThreadCache()
+{
+    tCacheDestroyed = true;
+    PooledAllocator& allocator = thePooledAllocator();
+    for (std::vector<Buffer*>& freeList : mFree) {
+        for (Buffer* segment : freeList) {
+            allocator.freed(segment->capacity(), false);
+            delete segment;
+        }
+    }
+}
+
+PooledAllocator::ThreadCache* PooledAllocator::threadCache()
+{
+    if (tCacheDestroyed)
+        return nullptr;
+    thread_local ThreadCache cache;
+    return &cache;
+}
+
+BufferUniquePtr PooledAllocator::allocate(size_t size)
+{
+    if (size > MAX_POOLED_SIZE) {
+        BufferUniquePtr segment(newSegment(size));
+        allocated(size);
+        return segment;
+    }
+
+    size_t index = sizeClass(size);
+    Buffer* segment = nullptr;
+    if (index < SMALL_CLASSES) {
+        ThreadCache* cache = threadCache();
+        if (cache && !cache->mFree[index].empty()) {
+            segment = cache->mFree[index].back();
+            cache->mFree[index].pop_back();
+            cache->mBytes -= segment->capacity();
+        }
+    } else {
+        std::lock_guard<std::mutex> lock(mSharedMutex);
+        std::vector<Buffer*>& freeList = mShared[index - SMALL_CLASSES];
+        if (!freeList.empty()) {
+            segment = freeList.back();
+            freeList.pop_back();
+            mSharedBytes -= segment->capacity();
+        }
+    }
+
+    if (segment) {
+        reused(segment->capacity());
+        segment->reset();
+        return BufferUniquePtr(segment);
+    }
+    size = classSize(index);
+    segment = newSegment(size);
+    allocated(size);
+    return BufferUniquePtr(segment);
+}
+
+void PooledAllocator::release(BufferUniquePtr&& segment)
+{
+    if (!segment || !segment->ownsData()) {
+        segment.reset();
+        return;
+    }
+    size_t capacity = segment->capacity();
+    if (capacity <= MAX_POOLED_SIZE) {
+        size_t index = sizeClass(capacity);
+        // only cache segments that are exactly a class size
+        if (classSize(index) == capacity) {
+            if (index < SMALL_CLASSES) {
+                ThreadCache* cache = threadCache();
+                if (cache && cache->mBytes + capacity <= THREAD_CACHE_BYTES) {
+                    cache->mFree[index].push_back(segment.release());
+                    cache->mBytes += capacity;
+                    cached(capacity);
+                    return;
+                }
+            } else {
+                std::lock_guard<std::mutex> lock(mSharedMutex);
+                if (mSharedBytes + capacity <= SHARED_CACHE_BYTES) {
+                    mShared[index - SMALL_CLASSES].push_back(segment.release());
+                    mSharedBytes += capacity;
+                    cached(capacity);
+                    return;
+                }
+            }
+        }
+    }
+    freed(capacity, true);
+    segment.reset();
+}
+
+} // namespace
+
+MultiBufferAllocator& MultiBufferAllocator::heap()
+{
+    static HeapAllocator allocator;
+    return allocator;
+}
+
+MultiBufferAllocator& MultiBufferAllocator::pooled()
+{
+    return thePooledAllocator();
+}
+
+}
+}
@@ -0,0 +1,79 @@
+// Copyright 2023-2024 DreamWorks Animation LLC and Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __ARRAS4_MULTIBUFFER_ALLOCATORH__
+#define __ARRAS4_MULTIBUFFER_ALLOCATORH__
+
+#include "network_types.h"
+
+#include <atomic>
+
+namespace arras4 {
+    namespace network {
+
+// MultiBufferAllocator provides the segment buffers used by a MultiBuffer.
+//
+// Segments are always ordinary heap Buffers that own their data, so a
+// segment taken from a MultiBuffer can be kept (or have its data released)
+// whatever allocator it came from. The allocators differ in what happens
+// to a segment when the MultiBuffer is finished with it :
+//
+//   heap()   : segments are allocated and freed normally, with exactly
+//              the requested capacity.
+//   pooled() : capacities are rounded up to a power of 2, and released
+//              segments are kept for reuse. Small segments (up to 512kb)
+//              are cached per thread, so a thread that repeatedly
+//              builds small messages doesn't lock or allocate. Larger
+//              segments (up to 64Mb) are cached in a shared pool.
+//              Both caches are limited in size.
+//
+// Both allocators are thread-safe.
+class MultiBufferAllocator
+{
+public:
+    struct Stats {
+        size_t residentBytes = 0;     // held by segments, either in use or cached
+        size_t peakResidentBytes = 0; // high water mark of residentBytes
+        size_t inUseBytes = 0;        // held by segments in use by MultiBuffers
+        size_t allocations = 0;       // segments allocated from the heap
+        size_t reuses = 0;            // segments supplied from a cache
+    };
+
+    static MultiBufferAllocator& heap();
+    static MultiBufferAllocator& pooled();
+
+    virtual ~MultiBufferAllocator() {}
+
+    // returns an empty segment with capacity of at least 'size'.
+    // throws OutOfMemoryError if allocation fails
+    virtual BufferUniquePtr allocate(size_t size) = 0;
+
+    // return a segment that is no longer needed. Buffers that don't
+    // own their data (e.g. added with MultiBuffer::addBuffer) are
+    // just deleted
+    virtual void release(BufferUniquePtr&& segment) = 0;
+
+    // called when a segment is taken out of a MultiBuffer, and so will
+    // never be released
+    void detach(const Buffer& segment);
+
+    Stats stats() const;
+
+protected:
+    // accounting for derived classes
+    void allocated(size_t bytes);
+    void reused(size_t bytes);
+    void cached(size_t bytes);
+    void freed(size_t bytes, bool inUse);
+
+private:
+    std::atomic<size_t> mResidentBytes{0};
+    std::atomic<size_t> mPeakResidentBytes{0};
+    std::atomic<size_t> mInUseBytes{0};
+    std::atomic<size_t> mAllocations{0};
+    std::atomic<size_t> mReuses{0};
+};
+
+}
+}
+#endif
@@ -0,0 +1,124 @@
+// Copyright 2023-2024 DreamWorks Animation LLC and Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "NonBlockingFramingSink.h"
+#include "SocketPeer.h"
+#include "Buffer.h"
+#include "Frame.h"
+#include "FramingError.h"
+#include "OutOfMemoryError.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+    // maximum number of queued frames passed to a single send
+    const size_t MAX_SEGMENTS = 64;
+}
+
+namespace arras4 {
+    namespace network {
+
+NonBlockingFramingSink::NonBlockingFramingSink(SocketPeer& peer) :
+    mPeer(peer)
+{
+}
+
+NonBlockingFramingSink::~NonBlockingFramingSink()
+{
+}
+
+void NonBlockingFramingSink::setFrameVersion(unsigned version)
+{
+    mFrameVersion = std::min(version, Frame::VERSION_CURRENT);
+}
+
+size_t NonBlockingFramingSink::bytesWritten() const
+{
+    if (mCurrent)
+        return mCurrent->remaining() - sizeof(Frame);
+    return 0;
+}
+
+bool NonBlockingFramingSink::openFrame(size_t frameSize)
+{
+    if (frameSize > Frame::maxLength(mFrameVersion))
+        throw FramingError("Data is too long for the framing protocol. Limit is ~4Gb unless the receiver supports large frames");
+
+    Frame frameHdr;
+    frameHdr.mType = Frame::FRAME_BINARY;
+    frameHdr.setLength(frameSize);
+
+    try {
+        mCurrent = BufferPtr(new Buffer(sizeof(Frame) + frameSize));
+    } catch (std::bad_alloc&) {
+        throw OutOfMemoryError("Write buffer allocation failed : out of memory?");
+    }
+    mCurrent->write(reinterpret_cast<unsigned char*>(&frameHdr), sizeof(frameHdr));
+    mFrameSize = frameSize;
+    return true;
+}
+
+size_t NonBlockingFramingSink::write(const unsigned char* aBuf, size_t aLen)
+{
+    if (!mCurrent || aLen > mCurrent->remainingCapacity())
+        throw FramingError("Attempt to write beyond end of data frame");
+    mCurrent->write(aBuf, aLen);
+    return aLen;
+}
+
+bool NonBlockingFramingSink::closeFrame()
+{
+    if (!mCurrent || mCurrent->remainingCapacity() != 0)
+        throw FramingError("Not enough data written to fill frame");
+    {
+        std::lock_guard<std::mutex> lock(mQueueMutex);
+        mPendingBytes += mCurrent->remaining();
+        mQueue.push_back(mCurrent);
+    }
+    mCurrent.reset();
+    mFrameSize = 0;
+    sendPending();
+    return true;
+}
+
+void NonBlockingFramingSink::flush()
+{
+    sendPending();
+}
+
+bool NonBlockingFramingSink::sendPending()
+{
+    std::lock_guard<std::mutex> lock(mQueueMutex);
+    std::vector<DataSegment> segments;
+    while (!mQueue.empty()) {
+        segments.clear();
+        for (size_t i = 0; i < mQueue.size() && i < MAX_SEGMENTS; i++) {
+            segments.push_back({ mQueue[i]->start(), mQueue[i]->remaining() });
+        }
+        size_t sent = mPeer.send_nonblocking(segments.data(), segments.size());
+        if (sent == 0)
+            return false; // socket buffer full : wait for WRITABLE
+        mPendingBytes -= sent;
+
+        // remove or advance the frames that were sent
+        while (sent > 0) {
+            const BufferPtr& front = mQueue.front();
+            size_t n = std::min(sent, front->remaining());
+            front->skip(n);
+            sent -= n;
+            if (front->remaining() == 0)
+                mQueue.pop_front();
+        }
+    }
+    return true;
+}
+
+size_t NonBlockingFramingSink::pendingBytes() const
+{
+    std::lock_guard<std::mutex> lock(mQueueMutex);
+    return mPendingBytes;
+}
+
+}
+}
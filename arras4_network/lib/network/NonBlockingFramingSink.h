@@ -0,0 +1,68 @@
+// Copyright 2023-2024 DreamWorks Animation LLC and Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __ARRAS4_NONBLOCKING_FRAMING_SINKH__
+#define __ARRAS4_NONBLOCKING_FRAMING_SINKH__
+
+#include "network_types.h"
+#include "DataSink.h"
+
+#include <deque>
+#include <mutex>
+
+namespace arras4 {
+    namespace network {
+
+// Writes BasicFraming frames to a non-blocking SocketPeer, for use
+// with EventLoop.
+//
+// Frames are queued when they are closed, and sent as far as the socket
+// will accept without blocking. Call sendPending() from the peer's
+// WRITABLE callback to continue sending once the socket drains. A
+// BufferedSink can be attached to this in place of a BasicFramingSink,
+// so that MessageWriter works unchanged.
+//
+// Frame writing and sendPending() may be called on different threads.
+class NonBlockingFramingSink : public FramedSink
+{
+public:
+    NonBlockingFramingSink(SocketPeer& peer);
+    ~NonBlockingFramingSink();
+
+    NonBlockingFramingSink(const NonBlockingFramingSink&) = delete;
+    NonBlockingFramingSink& operator=(const NonBlockingFramingSink&) = delete;
+
+    // required FramedSink interface
+    size_t write(const unsigned char* aBuf, size_t aLen);
+    void flush();
+    size_t bytesWritten() const;
+    bool openFrame(size_t frameSize);
+    bool closeFrame();
+
+    // highest frame header version that the receiver understands
+    // (see Frame.h and BasicFramingSink::setFrameVersion)
+    void setFrameVersion(unsigned version);
+
+    // send as much queued data as possible without blocking.
+    // Returns true if the queue is now empty
+    bool sendPending();
+
+    // number of bytes queued but not yet sent
+    size_t pendingBytes() const;
+
+private:
+    SocketPeer& mPeer;
+
+    // frame currently being written (including header)
+    BufferPtr mCurrent;
+    size_t mFrameSize = 0;
+    unsigned mFrameVersion = 0; // Frame::VERSION_BASIC
+
+    mutable std::mutex mQueueMutex;
+    std::deque<BufferPtr> mQueue;
+    size_t mPendingBytes = 0;
+};
+
+}
+}
+#endif
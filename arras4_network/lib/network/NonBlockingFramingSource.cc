@@ -0,0 +1,170 @@
+// Copyright 2023-2024 DreamWorks Animation LLC and Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "NonBlockingFramingSource.h"
+#include "SocketPeer.h"
+#include "Buffer.h"
+#include "FramingError.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace {
+    // size of the read staging buffer
+    const size_t STAGING_SIZE = 64*1024;
+}
+
+namespace arras4 {
+    namespace network {
+
+NonBlockingFramingSource::NonBlockingFramingSource(SocketPeer& peer,
+                                                   const std::shared_ptr<BufferPool>& pool) :
+    mPeer(peer),
+    mPool(pool),
+    mStaging(STAGING_SIZE)
+{
+}
+
+NonBlockingFramingSource::~NonBlockingFramingSource()
+{
+}
+
+size_t NonBlockingFramingSource::receiveAvailable()
+{
+    while (true) {
+        // large frame bodies are received directly into the frame
+        // buffer, everything else goes via the staging area
+        if (mFilling && fillRemaining() >= mStaging.size()) {
+            size_t r = mPeer.receive_nonblocking(mFilling->end(), fillRemaining());
+            if (r == 0) break;
+            unsigned char* dummy;
+            mFilling->assign(dummy, r);
+            consume(nullptr, 0);
+        } else {
+            size_t r = mPeer.receive_nonblocking(mStaging.data(), mStaging.size());
+            if (r == 0) break;
+            consume(mStaging.data(), r);
+        }
+    }
+    return framesReady();
+}
+
+// add received data to the frame(s) being assembled
+size_t NonBlockingFramingSource::consume(const unsigned char* data, size_t length)
+{
+    size_t used = 0;
+    while (true) {
+        if (!mFilling) {
+            if (used == length) break;
+            size_t toCopy = std::min(length - used, sizeof(Frame) - mHeaderBytes);
+            std::memcpy(reinterpret_cast<unsigned char*>(&mHeader) + mHeaderBytes,
+                        data + used, toCopy);
+            mHeaderBytes += toCopy;
+            used += toCopy;
+            if (mHeaderBytes < sizeof(Frame)) break;
+            mHeaderBytes = 0;
+            if (mHeader.mVersion > Frame::VERSION_CURRENT)
+                throw FramingError("Unsupported frame header version");
+            if (mHeader.length() == 0) continue; // empty frames carry no message
+            mFilling = mPool->acquire(mHeader.length());
+        }
+        used += mFilling->write(data + used, std::min(length - used, fillRemaining()));
+        if (fillRemaining() > 0) break;
+        std::lock_guard<std::mutex> lock(mReadyMutex);
+        mReady.push_back(mFilling);
+        mFilling.reset();
+    }
+    return used;
+}
+
+// bytes still needed to complete the frame being assembled. Pooled
+// buffers may be larger than the frame, so this is not remainingCapacity()
+size_t NonBlockingFramingSource::fillRemaining() const
+{
+    return mHeader.length() - mFilling->remaining();
+}
+
+size_t NonBlockingFramingSource::framesReady() const
+{
+    std::lock_guard<std::mutex> lock(mReadyMutex);
+    return mReady.size();
+}
+
+size_t NonBlockingFramingSource::nextFrame()
+{
+    std::lock_guard<std::mutex> lock(mReadyMutex);
+    if (mReady.empty())
+        return 0;
+    mBuffer = mReady.front();
+    mReady.pop_front();
+    return mBuffer->remaining();
+}
+
+void NonBlockingFramingSource::endFrame()
+{
+    mBuffer.reset();
+}
+
+size_t NonBlockingFramingSource::bytesRead() const
+{
+    if (mBuffer)
+        return mBuffer->consumed();
+    return 0;
+}
+
+BufferPtr NonBlockingFramingSource::takeBuffer()
+{
+    BufferPtr ret;
+    ret.swap(mBuffer);
+    return ret;
+}
+
+size_t NonBlockingFramingSource::read(unsigned char* aBuf, size_t aLen)
+{
+    if (!mBuffer)
+        throw FramingError("Attempt to read without message data");
+    if (aLen > mBuffer->remaining())
+        throw FramingError("Attempt to read beyond end of message data");
+    mBuffer->read(aBuf, aLen);
+    return aLen;
+}
+
+const unsigned char* NonBlockingFramingSource::readWindow(size_t& aAvailable)
+{
+    if (!mBuffer) {
+        aAvailable = 0;
+        return nullptr;
+    }
+    return mBuffer->readWindow(aAvailable);
+}
+
+void NonBlockingFramingSource::commitRead(size_t aLength)
+{
+    if (mBuffer)
+        mBuffer->commitRead(aLength);
+}
+
+size_t NonBlockingFramingSource::skip(size_t aLen)
+{
+    if (!mBuffer)
+        throw FramingError("Attempt to skip without message data");
+    if (aLen > mBuffer->remaining())
+        throw FramingError("Attempt to skip beyond end of message data");
+    mBuffer->skip(aLen);
+    return aLen;
+}
+
+bool NonBlockingFramingSource::writeToFile(const std::string& filepath)
+{
+    if (!mBuffer) return false;
+    std::ofstream ofs(filepath.c_str());
+    if (!ofs) return false;
+    ofs.write(reinterpret_cast<char*>(mBuffer->initial()),
+              mBuffer->consumed() + mBuffer->remaining());
+    ofs.close();
+    return bool(ofs);
+}
+
+}
+}
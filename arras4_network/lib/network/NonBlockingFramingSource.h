@@ -0,0 +1,90 @@
+// Copyright 2023-2024 DreamWorks Animation LLC and Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __ARRAS4_NONBLOCKING_FRAMING_SOURCEH__
+#define __ARRAS4_NONBLOCKING_FRAMING_SOURCEH__
+
+#include "network_types.h"
+#include "DataSource.h"
+#include "Frame.h"
+#include "BufferPool.h"
+
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace arras4 {
+    namespace network {
+
+// Reads BasicFraming frames from a non-blocking SocketPeer, for use
+// with EventLoop.
+//
+// Call receiveAvailable() from the peer's READABLE callback : it reads
+// all the data currently available and assembles it into complete frames,
+// each held in its own Buffer from 'pool'. The frames are then delivered through the
+// DetachableBufferSource interface, so that a MessageReader can be attached
+// directly in place of a BufferedSource. nextFrame() returns 0 (the usual
+// timeout indication) when no complete frame is ready, so MessageReader::read
+// returns an empty envelope rather than blocking.
+//
+// receiveAvailable() and the reading functions may be called on different
+// threads.
+class NonBlockingFramingSource : public DetachableBufferSource
+{
+public:
+    NonBlockingFramingSource(SocketPeer& peer,
+                             const std::shared_ptr<BufferPool>& pool = BufferPool::defaultPool());
+    ~NonBlockingFramingSource();
+
+    NonBlockingFramingSource(const NonBlockingFramingSource&) = delete;
+    NonBlockingFramingSource& operator=(const NonBlockingFramingSource&) = delete;
+
+    // read until the peer has no more data available. Returns
+    // the number of complete frames now waiting to be read.
+    // Throws PeerDisconnectException if the peer closes the connection
+    size_t receiveAvailable();
+
+    // number of complete frames waiting to be read
+    size_t framesReady() const;
+
+    // required DataSource interface. reads data from
+    // the current frame
+    size_t read(unsigned char* aBuf, size_t aLen);
+    size_t skip(size_t aLen);
+    size_t bytesRead() const;
+    const unsigned char* readWindow(size_t& aAvailable);
+    void commitRead(size_t aLength);
+
+    // returns size of the next complete frame, or 0 if none is ready
+    size_t nextFrame();
+    void endFrame();
+
+    BufferPtr takeBuffer();
+    bool writeToFile(const std::string& filepath);
+
+private:
+    size_t consume(const unsigned char* data, size_t length);
+    size_t fillRemaining() const;
+
+    SocketPeer& mPeer;
+    std::shared_ptr<BufferPool> mPool;
+
+    // staging area for socket reads, so that several small
+    // frames can be received with a single system call
+    std::vector<unsigned char> mStaging;
+
+    // frame currently being assembled
+    Frame mHeader;
+    size_t mHeaderBytes = 0;
+    BufferPtr mFilling;
+
+    mutable std::mutex mReadyMutex;
+    std::deque<BufferPtr> mReady;
+
+    // frame currently being read
+    BufferPtr mBuffer;
+};
+
+}
+}
+#endif
@@ -28,6 +28,15 @@ size_t PeerSourceAndSink::write(const unsigned char* aBuf, size_t aLen)
     return aLen;
 }
 
+size_t PeerSourceAndSink::writeSegments(const DataSegment* aSegments, size_t aCount)
+{
+    mPeer.send_segments_or_throw(aSegments,aCount,"Sink write");
+    size_t total = 0;
+    for (size_t i = 0; i < aCount; i++)
+        total += aSegments[i].length;
+    return total;
+}
+
 void PeerSourceAndSink::flush()
 {
 }
@@ -37,5 +46,20 @@ size_t PeerSourceAndSink::bytesWritten() const
     return mPeer.bytesWritten();
 }
 
+bool Peer::send_segments(const DataSegment* segments, size_t count)
+{
+    bool sentAny = false;
+    for (size_t i = 0; i < count; i++) {
+        if (segments[i].length == 0) continue;
+        if (!send(segments[i].data, segments[i].length)) {
+            if (sentAny)
+                throw_disconnect("Peer::send_segments partial message sent");
+            return false;
+        }
+        sentAny = true;
+    }
+    return true;
+}
+
 }
 }
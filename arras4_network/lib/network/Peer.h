@@ -24,6 +24,7 @@ public:
     size_t skip(size_t aLen);
     size_t bytesRead() const;  
     size_t write(const unsigned char* aBuf, size_t aLen);
+    size_t writeSegments(const DataSegment* aSegments, size_t aCount);
     void flush();
     size_t bytesWritten() const;
 
@@ -53,6 +54,18 @@ public:
         }
     }
 
+    // send a sequence of data blocks to the remote endpoint (blocking), in order.
+    // Peers that support scatter-gather output override this to send all blocks 
+    // using as few system calls as possible : the default calls send() for 
+    // each block. Returns false if the remote endpoint stopped accepting data 
+    // before anything was sent
+    virtual bool send_segments(const DataSegment* segments, size_t count);
+    void send_segments_or_throw(const DataSegment* segments, size_t count, const char* message) {
+        if (!send_segments(segments, count)) {
+            throw_disconnect(message);
+        }
+    }
+
     // receive data from the remote endpoint (blocking); returns number of bytes read
     // by 'src' will contain the IPv4/IPv6 address/port source system information
     virtual size_t receive(void* buffer, size_t nMaxBytesToRead) = 0;
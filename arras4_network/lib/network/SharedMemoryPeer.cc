@@ -0,0 +1,615 @@
+// Copyright 2023-2024 DreamWorks Animation LLC and Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "SharedMemoryPeer.h"
+#include "SocketPeer.h"
+#include "InvalidParameterError.h"
+
+#include <sys/mman.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <errno.h>
+#include <new>
+#include <string.h>
+
+namespace arras4 {
+namespace network {
+
+// One ring buffer. 'head' and 'tail' are monotonically increasing byte
+// counts : the data lies between tail and head, modulo the capacity.
+// The producer and consumer fields are on separate cache lines.
+struct SharedMemoryPeer::RingControl
+{
+    // written by producer
+    alignas(64) std::atomic<uint64_t> head;
+    std::atomic<uint32_t> dataSeq;         // futex : bumped when data is added
+    std::atomic<uint32_t> readerWaiting;   // consumer is (about to be) in futex wait
+
+    // written by consumer
+    alignas(64) std::atomic<uint64_t> tail;
+    std::atomic<uint32_t> spaceSeq;        // futex : bumped when space is freed
+    std::atomic<uint32_t> writerWaiting;   // producer is (about to be) in futex wait
+
+    alignas(64) std::atomic<uint32_t> writerClosed;
+    std::atomic<uint32_t> readerClosed;
+};
+
+namespace {
+
+const uint32_t SHM_MAGIC = 0x41534d31; // "ASM1"
+const uint32_t SHM_VERSION = 1;
+const size_t PAGE_ALIGN = 4096;
+
+// number of times to check for data/space before waiting on the futex
+const int SPIN_COUNT = 200;
+
+struct SegmentHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t ringCapacity;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free &&
+              std::atomic<uint32_t>::is_always_lock_free,
+              "SharedMemoryPeer requires lock-free atomics");
+
+size_t roundUp(size_t value, size_t align)
+{
+    return (value + align - 1) / align * align;
+}
+
+size_t controlOffset(int ring)
+{
+    return roundUp(sizeof(SegmentHeader), 64) + ring * sizeof(SharedMemoryPeer::RingControl);
+}
+
+size_t dataOffset(int ring, size_t capacity)
+{
+    return roundUp(controlOffset(2), PAGE_ALIGN) + ring * capacity;
+}
+
+void futexWait(std::atomic<uint32_t>* addr, uint32_t expected, const struct timespec* timeout)
+{
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(addr), FUTEX_WAIT, expected, timeout, nullptr, 0);
+}
+
+void futexWake(std::atomic<uint32_t>* addr)
+{
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(addr), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+
+void notify(std::atomic<uint32_t>& seq, std::atomic<uint32_t>& waiting)
+{
+    seq.fetch_add(1);
+    if (waiting.load())
+        futexWake(&seq);
+}
+
+void throwErrno(const char* aWhere)
+{
+    int save_errno = errno;
+    std::string err(aWhere);
+    err += ": ";
+    err += strerror(save_errno);
+    throw PeerException(save_errno, err);
+}
+
+} // namespace
+
+SharedMemoryPeer::SharedMemoryPeer()
+    : mFd(-1),
+      mBase(nullptr),
+      mSize(0),
+      mSendRing(nullptr),
+      mSendData(nullptr),
+      mReceiveRing(nullptr),
+      mReceiveData(nullptr),
+      mCapacity(0),
+      mLivenessFd(-1),
+      mRemoteGone(false),
+      mShutdown(false),
+      mBytesRead(0),
+      mBytesWritten(0)
+{
+}
+
+SharedMemoryPeer::~SharedMemoryPeer()
+{
+    shutdown();
+    if (mBase) munmap(mBase, mSize);
+    if (mFd >= 0) close(mFd);
+    if (mLivenessFd >= 0) close(mLivenessFd);
+}
+
+void SharedMemoryPeer::create(size_t aRingCapacity)
+{
+    if (mFd >= 0)
+        throw InvalidParameterError("SharedMemoryPeer::create on a peer that is already connected");
+
+    // capacity must be a power of 2 to allow wrapping by masking
+    size_t capacity = PAGE_ALIGN;
+    while (capacity < aRingCapacity) capacity *= 2;
+
+    mFd = memfd_create("arras_shm_peer", MFD_CLOEXEC);
+    if (mFd < 0)
+        throwErrno("SharedMemoryPeer::create memfd_create");
+    size_t size = dataOffset(2, capacity);
+    if (ftruncate(mFd, size) < 0)
+        throwErrno("SharedMemoryPeer::create ftruncate");
+    map(size, true, capacity);
+
+    // creator sends on ring 0 and receives on ring 1
+    mSendRing = reinterpret_cast<RingControl*>(mBase + controlOffset(0));
+    mReceiveRing = reinterpret_cast<RingControl*>(mBase + controlOffset(1));
+    mSendData = mBase + dataOffset(0, mCapacity);
+    mReceiveData = mBase + dataOffset(1, mCapacity);
+}
+
+void SharedMemoryPeer::attach(int aFd)
+{
+    if (mFd >= 0)
+        throw InvalidParameterError("SharedMemoryPeer::attach on a peer that is already connected");
+
+    mFd = fcntl(aFd, F_DUPFD_CLOEXEC, 0);
+    if (mFd < 0)
+        throwErrno("SharedMemoryPeer::attach dup");
+    struct stat st;
+    if (fstat(mFd, &st) < 0)
+        throwErrno("SharedMemoryPeer::attach fstat");
+    if (static_cast<size_t>(st.st_size) < dataOffset(0, 0))
+        throw InvalidParameterError("SharedMemoryPeer::attach segment is too small");
+    map(st.st_size, false, 0);
+
+    // attacher sends on ring 1 and receives on ring 0
+    mSendRing = reinterpret_cast<RingControl*>(mBase + controlOffset(1));
+    mReceiveRing = reinterpret_cast<RingControl*>(mBase + controlOffset(0));
+    mSendData = mBase + dataOffset(1, mCapacity);
+    mReceiveData = mBase + dataOffset(0, mCapacity);
+}
+
+void SharedMemoryPeer::map(size_t aSize, bool aInitialize, size_t aRingCapacity)
+{
+    void* addr = mmap(nullptr, aSize, PROT_READ | PROT_WRITE, MAP_SHARED, mFd, 0);
+    if (addr == MAP_FAILED)
+        throwErrno("SharedMemoryPeer mmap");
+    mBase = static_cast<unsigned char*>(addr);
+    mSize = aSize;
+
+    SegmentHeader* header = reinterpret_cast<SegmentHeader*>(mBase);
+    if (aInitialize) {
+        header->magic = SHM_MAGIC;
+        header->version = SHM_VERSION;
+        header->ringCapacity = aRingCapacity;
+        for (int ring = 0; ring < 2; ring++) {
+            RingControl* rc = new (mBase + controlOffset(ring)) RingControl;
+            rc->head = 0; rc->dataSeq = 0; rc->readerWaiting = 0;
+            rc->tail = 0; rc->spaceSeq = 0; rc->writerWaiting = 0;
+            rc->writerClosed = 0; rc->readerClosed = 0;
+        }
+    } else if (header->magic != SHM_MAGIC || header->version != SHM_VERSION ||
+               dataOffset(2, header->ringCapacity) > aSize ||
+               (header->ringCapacity & (header->ringCapacity - 1)) != 0) {
+        throw InvalidParameterError("SharedMemoryPeer::attach not a valid shared memory peer segment");
+    }
+    mCapacity = header->ringCapacity;
+}
+
+void SharedMemoryPeer::offer(SocketPeer& aChannel)
+{
+    if (mFd < 0)
+        throw InvalidParameterError("SharedMemoryPeer::offer before create");
+
+    // the descriptor travels as ancillary data on a one byte message
+    char dummy = 'S';
+    struct iovec iov;
+    iov.iov_base = &dummy;
+    iov.iov_len = 1;
+
+    char control[CMSG_SPACE(sizeof(int))];
+    memset(control, 0, sizeof(control));
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &mFd, sizeof(int));
+
+    ssize_t status;
+    do {
+        status = sendmsg(aChannel.fd(), &msg, MSG_NOSIGNAL);
+    } while (status < 0 && errno == EINTR);
+    if (status < 0)
+        throwErrno("SharedMemoryPeer::offer");
+    watch(aChannel);
+}
+
+void SharedMemoryPeer::accept(SocketPeer& aChannel)
+{
+    char dummy;
+    struct iovec iov;
+    iov.iov_base = &dummy;
+    iov.iov_len = 1;
+
+    char control[CMSG_SPACE(sizeof(int))];
+    memset(control, 0, sizeof(control));
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    ssize_t status;
+    do {
+        status = recvmsg(aChannel.fd(), &msg, MSG_CMSG_CLOEXEC);
+    } while (status < 0 && errno == EINTR);
+    if (status < 0)
+        throwErrno("SharedMemoryPeer::accept");
+    if (status == 0)
+        throw_disconnect("SharedMemoryPeer::accept");
+
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    if (cmsg == nullptr ||
+        cmsg->cmsg_level != SOL_SOCKET ||
+        cmsg->cmsg_type != SCM_RIGHTS) {
+        throw PeerException(PeerException::INVALID_PROTOCOL, "SharedMemoryPeer::accept did not receive a segment descriptor");
+    }
+    int fd;
+    memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+    try {
+        attach(fd);
+    } catch (...) {
+        close(fd);
+        throw;
+    }
+    close(fd);
+    watch(aChannel);
+}
+
+void SharedMemoryPeer::watch(SocketPeer& aChannel)
+{
+    int fd = fcntl(aChannel.fd(), F_DUPFD_CLOEXEC, 0);
+    if (fd < 0)
+        throwErrno("SharedMemoryPeer::watch dup");
+    if (mLivenessFd >= 0) close(mLivenessFd);
+    mLivenessFd = fd;
+}
+
+// true if the liveness channel shows that the other process has gone.
+// Only called before waiting, so it doesn't cost anything while data
+// is flowing
+bool SharedMemoryPeer::remoteGone()
+{
+    if (mRemoteGone)
+        return true;
+    if (mLivenessFd < 0)
+        return false;
+    struct pollfd pfd;
+    pfd.fd = mLivenessFd;
+    pfd.events = POLLRDHUP;
+    pfd.revents = 0;
+    int status;
+    do {
+        status = ::poll(&pfd, 1, 0);
+    } while (status < 0 && errno == EINTR);
+    if (status > 0 && (pfd.revents & (POLLHUP | POLLRDHUP | POLLERR | POLLNVAL)))
+        mRemoteGone = true;
+    return mRemoteGone;
+}
+
+// futex timeout for a wait with 'aTimeoutMs' remaining (-1 = none) : waits
+// are bounded if there is a liveness channel to check
+int SharedMemoryPeer::waitTimeoutMs(int aTimeoutMs) const
+{
+    if (mLivenessFd < 0)
+        return aTimeoutMs;
+    if (aTimeoutMs < 0)
+        return LIVENESS_CHECK_MS;
+    return std::min(aTimeoutMs, LIVENESS_CHECK_MS);
+}
+
+void SharedMemoryPeer::checkConnected(const char* aWhere) const
+{
+    if (mBase == nullptr) {
+        std::string err(aWhere);
+        err += " on an unconnected peer";
+        throw InvalidParameterError(err);
+    }
+}
+
+// wait until the receive ring has data, it is closed, the other process
+// has gone, or the timeout expires (-1 = no timeout). Returns true if 
+// there is data to read
+bool SharedMemoryPeer::waitForData(int aTimeoutMs)
+{
+    RingControl* ring = mReceiveRing;
+    std::chrono::steady_clock::time_point endTime =
+        std::chrono::steady_clock::now() + std::chrono::milliseconds(std::max(aTimeoutMs, 0));
+
+    for (int spin = 0; ; spin++) {
+        if (ring->head.load(std::memory_order_acquire) != ring->tail.load(std::memory_order_relaxed))
+            return true;
+        if (ring->writerClosed.load() || mShutdown)
+            return false;
+        if (aTimeoutMs == 0)
+            return false;
+        if (spin < SPIN_COUNT)
+            continue;
+        if (remoteGone())
+            return false;
+
+        uint32_t seq = ring->dataSeq.load();
+        ring->readerWaiting.store(1);
+        // recheck after announcing we are waiting, so that
+        // a wakeup from the producer can't be missed
+        if (ring->head.load() != ring->tail.load() ||
+            ring->writerClosed.load() || mShutdown) {
+            ring->readerWaiting.store(0);
+            continue;
+        }
+
+        int waitMs = aTimeoutMs;
+        if (aTimeoutMs > 0) {
+            std::chrono::milliseconds left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                endTime - std::chrono::steady_clock::now());
+            if (left.count() <= 0) {
+                ring->readerWaiting.store(0);
+                return false;
+            }
+            waitMs = static_cast<int>(left.count());
+        }
+        waitMs = waitTimeoutMs(waitMs);
+        struct timespec ts;
+        struct timespec* timeout = nullptr;
+        if (waitMs >= 0) {
+            ts.tv_sec = waitMs / 1000;
+            ts.tv_nsec = (waitMs % 1000) * 1000000L;
+            timeout = &ts;
+        }
+        futexWait(&ring->dataSeq, seq, timeout);
+        ring->readerWaiting.store(0);
+    }
+}
+
+// wait until the send ring has space, it is closed or the other
+// process has gone. Returns true if there is space
+bool SharedMemoryPeer::waitForSpace()
+{
+    RingControl* ring = mSendRing;
+    for (int spin = 0; ; spin++) {
+        uint64_t used = ring->head.load(std::memory_order_relaxed) -
+            ring->tail.load(std::memory_order_acquire);
+        if (used < mCapacity)
+            return true;
+        if (ring->readerClosed.load() || mShutdown)
+            return false;
+        if (spin < SPIN_COUNT)
+            continue;
+        if (remoteGone())
+            return false;
+
+        uint32_t seq = ring->spaceSeq.load();
+        ring->writerWaiting.store(1);
+        if (ring->head.load() - ring->tail.load() < mCapacity ||
+            ring->readerClosed.load() || mShutdown) {
+            ring->writerWaiting.store(0);
+            continue;
+        }
+        int waitMs = waitTimeoutMs(-1);
+        struct timespec ts;
+        ts.tv_sec = waitMs / 1000;
+        ts.tv_nsec = (waitMs % 1000) * 1000000L;
+        futexWait(&ring->spaceSeq, seq, waitMs >= 0 ? &ts : nullptr);
+        ring->writerWaiting.store(0);
+    }
+}
+
+bool SharedMemoryPeer::send(const void* data, size_t nBytes)
+{
+    if (nBytes == 0) {
+        return true;
+    }
+    if (data == nullptr) {
+        throw InvalidParameterError("SharedMemoryPeer::send invalid null data ptr");
+    }
+    checkConnected("SharedMemoryPeer::send");
+
+    const unsigned char* src = static_cast<const unsigned char*>(data);
+    size_t sent = 0;
+    RingControl* ring = mSendRing;
+    while (sent < nBytes) {
+        if (ring->writerClosed.load() || !waitForSpace()) {
+            // if the remote endpoint has stopped accepting data
+            // before anything has been sent then return false
+            if (sent == 0) return false;
+            throw_disconnect("SharedMemoryPeer::send partial message sent");
+        }
+        uint64_t head = ring->head.load(std::memory_order_relaxed);
+        uint64_t tail = ring->tail.load(std::memory_order_acquire);
+        size_t space = mCapacity - (head - tail);
+        size_t toCopy = std::min(space, nBytes - sent);
+
+        // copy in up to two parts, wrapping at the end of the ring
+        size_t offset = head & (mCapacity - 1);
+        size_t first = std::min(toCopy, mCapacity - offset);
+        memcpy(mSendData + offset, src + sent, first);
+        if (toCopy > first)
+            memcpy(mSendData, src + sent + first, toCopy - first);
+
+        ring->head.store(head + toCopy);
+        notify(ring->dataSeq, ring->readerWaiting);
+        sent += toCopy;
+    }
+    mBytesWritten += sent;
+    return true;
+}
+
+size_t SharedMemoryPeer::receive(void* buffer, size_t nMaxBytesToRead)
+{
+    if (nMaxBytesToRead == 0) {
+        throw InvalidParameterError("SharedMemoryPeer::receive invalid byte count of 0");
+    }
+    if (buffer == nullptr) {
+        throw InvalidParameterError("SharedMemoryPeer::receive invalid null data ptr");
+    }
+    checkConnected("SharedMemoryPeer::receive");
+
+    if (!waitForData(-1))
+        return 0; // connection closed
+
+    RingControl* ring = mReceiveRing;
+    uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+    uint64_t head = ring->head.load(std::memory_order_acquire);
+    size_t toCopy = std::min(static_cast<size_t>(head - tail), nMaxBytesToRead);
+
+    unsigned char* dst = static_cast<unsigned char*>(buffer);
+    size_t offset = tail & (mCapacity - 1);
+    size_t first = std::min(toCopy, mCapacity - offset);
+    memcpy(dst, mReceiveData + offset, first);
+    if (toCopy > first)
+        memcpy(dst + first, mReceiveData, toCopy - first);
+
+    ring->tail.store(tail + toCopy);
+    notify(ring->spaceSeq, ring->writerWaiting);
+    mBytesRead += toCopy;
+    return toCopy;
+}
+
+bool SharedMemoryPeer::receive_all(void* buffer, size_t nBytesToRead, unsigned int aTimeoutMs)
+{
+    unsigned char* data8 = static_cast<unsigned char*>(buffer);
+    size_t offset = 0;
+    std::chrono::steady_clock::time_point endTime =
+        std::chrono::steady_clock::now() + std::chrono::milliseconds(aTimeoutMs);
+
+    while (offset < nBytesToRead) {
+        if (aTimeoutMs > 0) {
+            std::chrono::milliseconds left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                endTime - std::chrono::steady_clock::now());
+            int remaining = std::max(static_cast<int>(left.count()), 0);
+            if (!waitForData(remaining) &&
+                !mReceiveRing->writerClosed.load() && !mShutdown && !mRemoteGone) {
+                throw PeerException(ETIME, PeerException::TIMEOUT, "SharedMemoryPeer::receive_all: Timeout expire");
+            }
+        }
+        size_t status = receive(data8 + offset, nBytesToRead - offset);
+        if (status == 0) {
+            if (offset == 0) {
+                // return false if it simply couldn't read anything
+                return false;
+            }
+            throw_disconnect("SharedMemoryPeer::receive_all partial receive");
+        }
+        offset += status;
+    }
+    return true;
+}
+
+size_t SharedMemoryPeer::peek(void* buffer, size_t nMaxBytesToPeek)
+{
+    if (nMaxBytesToPeek == 0) {
+        throw InvalidParameterError("SharedMemoryPeer::peek invalid byte count of 0");
+    }
+    if (buffer == nullptr) {
+        throw InvalidParameterError("SharedMemoryPeer::peek invalid null data ptr");
+    }
+    checkConnected("SharedMemoryPeer::peek");
+
+    if (!waitForData(-1))
+        return 0;
+
+    RingControl* ring = mReceiveRing;
+    uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+    uint64_t head = ring->head.load(std::memory_order_acquire);
+    size_t toCopy = std::min(static_cast<size_t>(head - tail), nMaxBytesToPeek);
+
+    unsigned char* dst = static_cast<unsigned char*>(buffer);
+    size_t offset = tail & (mCapacity - 1);
+    size_t first = std::min(toCopy, mCapacity - offset);
+    memcpy(dst, mReceiveData + offset, first);
+    if (toCopy > first)
+        memcpy(dst + first, mReceiveData, toCopy - first);
+    return toCopy;
+}
+
+// returns true if the remote endpoint has closed the connection
+bool SharedMemoryPeer::poll(bool query_read, bool& read,
+                            bool query_write, bool& write,
+                            unsigned int timeoutMs)
+{
+    if (query_read) read = false;
+    if (query_write) write = false;
+    checkConnected("SharedMemoryPeer::poll");
+    if (!query_read && !query_write) {
+        throw InvalidParameterError("Neither read nor status is being queried");
+    }
+
+    bool closed = false;
+    if (query_read) {
+        read = waitForData(static_cast<int>(timeoutMs));
+        if (!read && (mReceiveRing->writerClosed.load() || mShutdown || remoteGone())) {
+            read = true;
+            closed = true;
+        }
+    }
+    if (query_write) {
+        write = (mSendRing->head.load() - mSendRing->tail.load()) < mCapacity &&
+            !mSendRing->readerClosed.load() && !mRemoteGone;
+    }
+    return closed;
+}
+
+void SharedMemoryPeer::shutdown_send()
+{
+    checkConnected("SharedMemoryPeer::shutdown_send");
+    mSendRing->writerClosed.store(1);
+    notify(mSendRing->dataSeq, mSendRing->readerWaiting);
+}
+
+void SharedMemoryPeer::shutdown_receive()
+{
+    checkConnected("SharedMemoryPeer::shutdown_receive");
+    mReceiveRing->readerClosed.store(1);
+    notify(mReceiveRing->spaceSeq, mReceiveRing->writerWaiting);
+}
+
+// marks both directions closed and wakes every waiter, local or remote.
+// The segment stays mapped until destruction, so threads blocked in
+// send or receive can return safely
+void SharedMemoryPeer::threadSafeShutdown()
+{
+    if (mBase == nullptr) return;
+    mShutdown = true;
+    mSendRing->writerClosed.store(1);
+    mReceiveRing->readerClosed.store(1);
+    for (RingControl* ring : { mSendRing, mReceiveRing }) {
+        ring->dataSeq.fetch_add(1);
+        futexWake(&ring->dataSeq);
+        ring->spaceSeq.fetch_add(1);
+        futexWake(&ring->spaceSeq);
+    }
+}
+
+void SharedMemoryPeer::shutdown()
+{
+    threadSafeShutdown();
+}
+
+} // end namespace network
+} // end namespace arras4
@@ -0,0 +1,131 @@
+// Copyright 2023-2024 DreamWorks Animation LLC and Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __ARRAS4_SHAREDMEMORYPEER_H__
+#define __ARRAS4_SHAREDMEMORYPEER_H__
+
+#include "Peer.h"
+
+#include <atomic>
+#include <cstdint>
+
+namespace arras4 {
+namespace network {
+
+// default capacity of each ring (64Mb)
+constexpr size_t DEFAULT_SHM_RING_CAPACITY = 64*1024*1024;
+
+// interval at which a blocked peer checks that the other process
+// is still there
+constexpr int LIVENESS_CHECK_MS = 100;
+
+// SharedMemoryPeer connects two processes on the same machine through
+// a shared memory segment (Linux only), avoiding the copies through the
+// kernel that a Unix domain socket requires.
+//
+// The segment is an anonymous memfd holding two single-producer/single-consumer
+// ring buffers, one for each direction. A blocked reader or writer waits on
+// a futex in the segment, so no system call is made unless one side actually
+// has to wait.
+//
+// One side calls create() and the other attach(), with the segment file
+// descriptor passed between them. The simplest way to do that is over
+// an existing IPCSocketPeer connection, using offer() and accept() :
+//
+//      creator                           attacher
+//      shm.create(capacity);
+//      shm.offer(ipcPeer);  ----------> shm.accept(ipcPeer);
+//
+// after which the IPC connection is no longer needed for data. Since this
+// is a Peer, it can be used with PeerMessageEndpoint and ChunkingMessageEndpoint
+// in place of a socket peer.
+//
+// A process that crashes or is killed never marks its rings closed, so
+// the IPC connection is kept as a liveness channel : offer() and accept()
+// hold a duplicate of its descriptor, and a blocked reader or writer
+// wakes every LIVENESS_CHECK_MS to check it for hangup. When the other
+// process has gone, the peer behaves as if it had been closed, as a
+// socket would. Both processes should keep the IPC connection open for
+// as long as the shared memory peer is in use.
+//
+// Each ring supports one sending thread and one receiving thread at a time.
+class SharedMemoryPeer : public Peer {
+  public:
+    SharedMemoryPeer();
+    ~SharedMemoryPeer();
+
+    SharedMemoryPeer(const SharedMemoryPeer&) = delete;
+    SharedMemoryPeer& operator=(const SharedMemoryPeer&) = delete;
+
+    // create a new segment with two rings of the given capacity (rounded
+    // up to a power of 2)
+    void create(size_t aRingCapacity = DEFAULT_SHM_RING_CAPACITY);
+
+    // attach to a segment created by another SharedMemoryPeer. Takes a
+    // duplicate of 'aFd', so the caller still owns it
+    void attach(int aFd);
+
+    // send the segment descriptor over a Unix domain socket peer.
+    // Must be called after create()
+    void offer(SocketPeer& aChannel);
+
+    // receive a segment descriptor sent by offer(), and attach to it
+    void accept(SocketPeer& aChannel);
+
+    // use a socket connected to the other process to detect that it
+    // has gone. Takes a duplicate of the descriptor. offer() and accept()
+    // call this with their channel
+    void watch(SocketPeer& aChannel);
+
+    // file descriptor of the segment, or -1 if not created/attached
+    int fd() const { return mFd; }
+
+    // Peer implementation
+    void shutdown();
+    void shutdown_send();
+    void shutdown_receive();
+    void threadSafeShutdown();
+    bool send(const void* data, size_t nBytes);
+    size_t receive(void* buffer, size_t nMaxBytesToRead);
+    bool receive_all(void* buffer, size_t nBytesToRead, unsigned int aTimeoutMs = 0);
+    size_t peek(void* buffer, size_t nMaxBytesToPeek);
+    bool poll(bool query_read, bool& read,
+              bool query_write, bool& write,
+              unsigned int timeoutMs = 0);
+
+    size_t bytesRead() const { return mBytesRead; }
+    size_t bytesWritten() const { return mBytesWritten; }
+
+    // control block for one ring, stored in the shared segment
+    struct RingControl;
+
+  private:
+    void map(size_t aSize, bool aInitialize, size_t aRingCapacity);
+    bool waitForData(int aTimeoutMs);
+    bool waitForSpace();
+    bool remoteGone();
+    int waitTimeoutMs(int aTimeoutMs) const;
+    void checkConnected(const char* aWhere) const;
+
+    int mFd;
+    unsigned char* mBase;
+    size_t mSize;
+
+    RingControl* mSendRing;
+    unsigned char* mSendData;
+    RingControl* mReceiveRing;
+    unsigned char* mReceiveData;
+    size_t mCapacity;
+
+    int mLivenessFd;
+    std::atomic<bool> mRemoteGone;
+
+    std::atomic<bool> mShutdown;
+    size_t mBytesRead;
+    size_t mBytesWritten;
+};
+
+} // end namespace network
+} // end namespace arras4
+
+#endif // __ARRAS4_SHAREDMEMORYPEER_H__
@@ -24,9 +24,12 @@ typedef SSIZE_T ssize_t;
 #include <netinet/tcp.h>
 #include <netdb.h>
 #include <sys/ioctl.h>
+#include <sys/uio.h>
+#include <fcntl.h>
 #include <unistd.h>
 #include <sys/time.h>
 #include <sys/types.h>
+#include <limits.h>
 
 #define USE_POLL 1
 #include <poll.h>
@@ -44,7 +47,9 @@ typedef SSIZE_T ssize_t;
 #include <sys/stat.h>
 #include <stdlib.h>
 #include <string.h>
+#include <algorithm>
 #include <sstream>
+#include <vector>
 
 #if !defined(timeradd)
 #define timeradd(tvp, uvp, vvp)                                         \
@@ -130,6 +135,20 @@ namespace {
         return status;
     }
 
+#ifndef PLATFORM_WINDOWS
+    ssize_t
+        sendmsg_ignore_interrupts(ARRAS_SOCKET s, const struct msghdr* msg, int flags)
+    {
+        ssize_t status = 0;
+
+        do {
+            status = ::sendmsg(s, msg, flags);
+        } while ((status < 0) && (get_socket_error() == EINTR));
+
+        return status;
+    }
+#endif
+
 #ifdef USE_POLL
     // this version of poll won't handle the timeout properly since the
     // call will be remade with the entire timeout properly. 0 (return immediately)
@@ -307,6 +326,7 @@ namespace arras4 {
         SocketPeer::SocketPeer()
             : mSocket(ARRAS_INVALID_SOCKET)
             , mIsListening(false)
+            , mIsNonBlocking(false)
             , mBytesRead(0)
             , mBytesWritten(0)
         {
@@ -315,6 +335,7 @@ namespace arras4 {
         SocketPeer::SocketPeer(ARRAS_SOCKET sock)
             : mSocket(ARRAS_INVALID_SOCKET)
             , mIsListening(false)
+            , mIsNonBlocking(false)
             , mBytesRead(0)
             , mBytesWritten(0)
         {
@@ -517,6 +538,192 @@ namespace arras4 {
             return true;
         }
 
+        bool
+            SocketPeer::send_segments(const DataSegment* segments, size_t count)
+        {
+#ifdef PLATFORM_WINDOWS
+            return Peer::send_segments(segments, count);
+#else
+            if (mIsListening) {
+                throw InvalidParameterError("SocketPeer::send_segments on an listening socket");
+            }
+
+            // encrypted writes have to go through the encryption
+            // object one block at a time
+            if (mEncryption != nullptr) {
+                return Peer::send_segments(segments, count);
+            }
+
+            std::vector<struct iovec> iov;
+            iov.reserve(count);
+            size_t total = 0;
+            for (size_t i = 0; i < count; i++) {
+                if (segments[i].length == 0) continue;
+                if (segments[i].data == nullptr) {
+                    throw InvalidParameterError("SocketPeer::send_segments invalid null data ptr");
+                }
+                struct iovec v;
+                v.iov_base = const_cast<unsigned char*>(segments[i].data);
+                v.iov_len = segments[i].length;
+                iov.push_back(v);
+                total += segments[i].length;
+            }
+            if (total == 0) {
+                return true;
+            }
+
+            size_t first = 0; // first iovec with unsent data
+            size_t sent = 0;
+            while (first < iov.size()) {
+
+                struct msghdr msg;
+                memset(&msg, 0, sizeof(msg));
+                msg.msg_iov = &iov[first];
+                msg.msg_iovlen = std::min(iov.size() - first, static_cast<size_t>(IOV_MAX));
+
+                ssize_t status = sendmsg_ignore_interrupts(mSocket, &msg, MSG_NOSIGNAL);
+                if (status < 0) {
+                    // save errno before doing anything else
+                    int save_errno = getSocketError();
+
+                    // throw an exception
+                    std::string err("SocketPeer::send_segments: ");
+                    err += getErrorString(save_errno);
+                    throw PeerException(save_errno, getCodeFromSocketError(save_errno), err);
+                }
+
+                // if the remote endpoint has stopped accepting data
+                // before anything has been sent then return false
+                // if a partial message is sent then throw an exception
+                if (status == 0) {
+                    if (sent == 0) {
+                        return false;
+                    }
+                    else {
+                        throw_disconnect("SocketPeer::send_segments partial message sent");
+                    }
+                }
+
+                sent += status;
+
+                // skip past the iovecs that were completely sent, and
+                // adjust the first partially sent one
+                size_t done = static_cast<size_t>(status);
+                while (first < iov.size() && done >= iov[first].iov_len) {
+                    done -= iov[first].iov_len;
+                    first++;
+                }
+                if (done > 0) {
+                    iov[first].iov_base = static_cast<uint8_t*>(iov[first].iov_base) + done;
+                    iov[first].iov_len -= done;
+                }
+            }
+            mBytesWritten += sent;
+            return true;
+#endif
+        }
+
+        void
+            SocketPeer::setNonBlocking(bool aNonBlocking)
+        {
+#ifdef PLATFORM_WINDOWS
+            throw PeerException(PeerException::INVALID_OPERATION, "SocketPeer::setNonBlocking not supported on this platform");
+#else
+            if (mSocket == ARRAS_INVALID_SOCKET) {
+                throw InvalidParameterError("SocketPeer::setNonBlocking on an uninitialized peer");
+            }
+            if (aNonBlocking && mEncryption) {
+                throw PeerException(PeerException::INVALID_OPERATION, "SocketPeer::setNonBlocking not supported for encrypted connections");
+            }
+            int flags = fcntl(mSocket, F_GETFL, 0);
+            if (flags >= 0) {
+                flags = aNonBlocking ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK);
+                flags = fcntl(mSocket, F_SETFL, flags);
+            }
+            if (flags < 0) {
+                int save_errno = getSocketError();
+                std::string err("SocketPeer::setNonBlocking: ");
+                err += getErrorString(save_errno);
+                throw PeerException(save_errno, getCodeFromSocketError(save_errno), err);
+            }
+            mIsNonBlocking = aNonBlocking;
+#endif
+        }
+
+        size_t
+            SocketPeer::send_nonblocking(const DataSegment* segments, size_t count)
+        {
+#ifdef PLATFORM_WINDOWS
+            throw PeerException(PeerException::INVALID_OPERATION, "SocketPeer::send_nonblocking not supported on this platform");
+#else
+            if (!mIsNonBlocking) {
+                throw InvalidParameterError("SocketPeer::send_nonblocking on a blocking socket");
+            }
+
+            std::vector<struct iovec> iov;
+            iov.reserve(count);
+            for (size_t i = 0; i < count; i++) {
+                if (segments[i].length == 0) continue;
+                struct iovec v;
+                v.iov_base = const_cast<unsigned char*>(segments[i].data);
+                v.iov_len = segments[i].length;
+                iov.push_back(v);
+            }
+            if (iov.empty()) {
+                return 0;
+            }
+
+            struct msghdr msg;
+            memset(&msg, 0, sizeof(msg));
+            msg.msg_iov = iov.data();
+            msg.msg_iovlen = std::min(iov.size(), static_cast<size_t>(IOV_MAX));
+
+            ssize_t status = sendmsg_ignore_interrupts(mSocket, &msg, MSG_NOSIGNAL);
+            if (status < 0) {
+                int save_errno = getSocketError();
+                if (save_errno == EAGAIN || save_errno == EWOULDBLOCK) {
+                    return 0;
+                }
+                std::string err("SocketPeer::send_nonblocking: ");
+                err += getErrorString(save_errno);
+                throw PeerException(save_errno, getCodeFromSocketError(save_errno), err);
+            }
+            mBytesWritten += status;
+            return status;
+#endif
+        }
+
+        size_t
+            SocketPeer::receive_nonblocking(void* buffer, size_t nMaxBytesToRead)
+        {
+#ifdef PLATFORM_WINDOWS
+            throw PeerException(PeerException::INVALID_OPERATION, "SocketPeer::receive_nonblocking not supported on this platform");
+#else
+            if (!mIsNonBlocking) {
+                throw InvalidParameterError("SocketPeer::receive_nonblocking on a blocking socket");
+            }
+            if (nMaxBytesToRead == 0 || buffer == nullptr) {
+                throw InvalidParameterError("SocketPeer::receive_nonblocking invalid buffer");
+            }
+
+            ssize_t rtn = recv_ignore_interrupts(mSocket, (char*)buffer, nMaxBytesToRead, MSG_NOSIGNAL);
+            if (rtn < 0) {
+                int save_errno = getSocketError();
+                if (save_errno == EAGAIN || save_errno == EWOULDBLOCK) {
+                    return 0;
+                }
+                std::string err("SocketPeer::receive_nonblocking: ");
+                err += getErrorString(save_errno);
+                throw PeerException(save_errno, getCodeFromSocketError(save_errno), err);
+            }
+            if (rtn == 0) {
+                throw_disconnect("SocketPeer::receive_nonblocking");
+            }
+            mBytesRead += rtn;
+            return rtn;
+#endif
+        }
+
         size_t
             SocketPeer::receive(void* buffer, size_t nMaxBytesToRead)
         {
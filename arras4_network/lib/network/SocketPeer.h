@@ -51,6 +51,7 @@ public:
     void shutdown_send(); // this connection won't be sending me data
     void shutdown_receive(); // this connection will not accept more data
     bool send(const void* data, size_t nBytes);
+    bool send_segments(const DataSegment* segments, size_t count);
     size_t receive(void* buffer, size_t nMaxBytesToRead);
     bool receive_all(void* buffer, size_t nBytesToRead, unsigned int aTimeoutMs = 0);
     size_t peek(void* buffer, size_t nMaxBytesToRead);
@@ -66,6 +67,23 @@ public:
     // HACK -- the select was done externally, and we know there are connections to accept...
     void acceptAll(Peer**& peers, int& nPeers);
 
+    // Non-blocking operation, for use with EventLoop. In non-blocking mode
+    // the regular send/receive functions should not be used : use
+    // send_nonblocking and receive_nonblocking instead. Not supported
+    // for encrypted connections.
+    void setNonBlocking(bool aNonBlocking);
+    bool isNonBlocking() const { return mIsNonBlocking; }
+
+    // send as much of the given segments as the socket will currently
+    // accept without blocking. Returns the number of bytes sent, which
+    // may be 0 if the socket buffer is full. Throws on error or disconnect
+    size_t send_nonblocking(const DataSegment* segments, size_t count);
+
+    // receive whatever data is currently available, up to nMaxBytesToRead,
+    // without blocking. Returns 0 if no data is available. Throws 
+    // PeerDisconnectException if the remote endpoint closed the connection
+    size_t receive_nonblocking(void* buffer, size_t nMaxBytesToRead);
+
     // layer encryption over the socket connection
     void setEncryption(std::unique_ptr<EncryptState> aState);
 
@@ -93,6 +111,7 @@ protected:
     std::unique_ptr<EncryptState> mEncryption;
 
     bool mIsListening;
+    bool mIsNonBlocking;
     size_t mBytesRead;
     size_t mBytesWritten;
 };
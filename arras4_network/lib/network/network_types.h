@@ -11,6 +11,7 @@ namespace arras4 {
 
         class Buffer;
         class MultiBuffer;
+        class MultiBufferAllocator;
         class DataSource;
         class DataSink;
         class Peer;
@@ -25,6 +26,10 @@ namespace arras4 {
         class BasicFramingSink;
         class BufferedSource;
         class BufferedSink;
+        class BufferPool;
+        class EventLoop;
+        class NonBlockingFramingSource;
+        class NonBlockingFramingSink;
 
         typedef std::shared_ptr<Buffer> BufferPtr;
         typedef std::shared_ptr<const Buffer> BufferConstPtr; 
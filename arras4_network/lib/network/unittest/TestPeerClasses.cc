@@ -9,6 +9,19 @@
 #include <network/InetSocketPeer.h>
 #include <network/IPCSocketPeer.h>
 #include <network/InvalidParameterError.h>
+#include <network/Frame.h>
+#include <network/FramingError.h>
+#include <network/BasicFramingSink.h>
+#include <network/BasicFramingSource.h>
+#include <network/BufferPool.h>
+#include <network/Buffer.h>
+#include <network/MultiBufferAllocator.h>
+#ifdef PLATFORM_LINUX
+#include <network/SharedMemoryPeer.h>
+#include <network/EventLoop.h>
+#include <network/NonBlockingFramingSink.h>
+#include <network/NonBlockingFramingSource.h>
+#endif
 
 #include <atomic>
 #include <fcntl.h>
@@ -16,10 +29,12 @@
 #include <signal.h>
 #include <string.h>
 #include <thread>
+#include <vector>
 
 #include <sys/resource.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
+#include <sys/wait.h>
 #include <unistd.h>
 
 #ifdef __ICC
@@ -905,6 +920,24 @@ void TestPeerClasses::testSocketPeerSend()
         delete inetPeer;
     }
 
+    TRACE;
+    //
+    // do a scatter-gather send, including an empty segment
+    //
+    {
+        unsigned char buffer[17]="0123456789012345";
+        arras4::network::DataSegment segments[3] = {
+            { buffer, 6 }, { nullptr, 0 }, { buffer + 6, 10 }
+        };
+        inetPeer = new InetSocketPeer("localhost", STANDARD_PORT);
+        CPPUNIT_ASSERT(inetPeer != nullptr);
+
+        CPPUNIT_ASSERT(inetPeer->send_segments(segments, 3));
+        CPPUNIT_ASSERT(inetPeer->bytesWritten() == 16);
+
+        delete inetPeer;
+    }
+
     stopInetServer();
 }
 
@@ -1819,3 +1852,697 @@ void TestPeerClasses::testPeerClasses()
     TRACE;
 }
 
+
+void TestPeerClasses::testSharedMemoryPeer()
+{
+#ifdef PLATFORM_LINUX
+    using arras4::network::SharedMemoryPeer;
+
+    TRACE;
+    //
+    // offer and accept a segment over a socket pair, then
+    // send data in both directions
+    //
+    {
+        int fds[2];
+        CPPUNIT_ASSERT(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+        SocketPeer channelA(fds[0]);
+        SocketPeer channelB(fds[1]);
+
+        SharedMemoryPeer creator;
+        SharedMemoryPeer attacher;
+        creator.create(4096);
+        creator.offer(channelA);
+        attacher.accept(channelB);
+        CPPUNIT_ASSERT(attacher.fd() >= 0);
+
+        char buffer[17] = { 0 };
+        CPPUNIT_ASSERT(creator.send(STANDARD_STRING16, 16));
+        CPPUNIT_ASSERT(attacher.receive_all(buffer, 16));
+        CPPUNIT_ASSERT(memcmp(buffer, STANDARD_STRING16, 16) == 0);
+        CPPUNIT_ASSERT(attacher.bytesRead() == 16);
+
+        memset(buffer, 0, sizeof(buffer));
+        CPPUNIT_ASSERT(attacher.send(STANDARD_STRING16, 16));
+        CPPUNIT_ASSERT(creator.receive_all(buffer, 16));
+        CPPUNIT_ASSERT(memcmp(buffer, STANDARD_STRING16, 16) == 0);
+
+        // closing the sending side ends the stream
+        creator.shutdown_send();
+        CPPUNIT_ASSERT(attacher.receive(buffer, 16) == 0);
+    }
+
+    TRACE;
+    //
+    // a process that dies without closing its rings is noticed
+    // through the socket used to offer the segment
+    //
+    {
+        int fds[2];
+        CPPUNIT_ASSERT(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+
+        SharedMemoryPeer creator;
+        creator.create(4096);
+
+        pid_t pid = fork();
+        CPPUNIT_ASSERT(pid >= 0);
+        if (pid == 0) {
+            close(fds[0]);
+            SocketPeer channel(fds[1]);
+            SharedMemoryPeer attacher;
+            attacher.accept(channel);
+            attacher.send(STANDARD_STRING16, 1);
+            for (;;) pause();
+        }
+
+        close(fds[1]);
+        SocketPeer channel(fds[0]);
+        creator.offer(channel);
+
+        char buffer[17] = { 0 };
+        CPPUNIT_ASSERT(creator.receive_all(buffer, 1));
+        CPPUNIT_ASSERT(buffer[0] == STANDARD_STRING16[0]);
+
+        kill(pid, SIGKILL);
+        waitpid(pid, nullptr, 0);
+
+        TestTimer timer;
+        timer.start();
+        CPPUNIT_ASSERT(creator.receive(buffer, 16) == 0);
+        bool read = false, write = false;
+        CPPUNIT_ASSERT(creator.poll(true, read, false, write, 0));
+        CPPUNIT_ASSERT(read);
+        // more than the ring holds, so the send has to wait for space
+        std::vector<char> big(8192, 'x');
+        CPPUNIT_ASSERT_THROW(creator.send(big.data(), big.size()), PeerException);
+        timer.stop();
+        CPPUNIT_ASSERT(timer.timeElapsed() < 5.0);
+    }
+
+    TRACE;
+    //
+    // data wraps around the end of the ring, both when it fits and
+    // when a send is larger than the whole ring
+    //
+    {
+        int fds[2];
+        CPPUNIT_ASSERT(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+        SocketPeer channelA(fds[0]);
+        SocketPeer channelB(fds[1]);
+
+        SharedMemoryPeer creator;
+        SharedMemoryPeer attacher;
+        creator.create(4096);
+        creator.offer(channelA);
+        attacher.accept(channelB);
+
+        // 1000 byte messages don't divide the ring, so every
+        // few messages straddle the end of it
+        std::vector<unsigned char> out(1000);
+        std::vector<unsigned char> in(1000);
+        for (int i = 0; i < 20; i++) {
+            for (size_t j = 0; j < out.size(); j++)
+                out[j] = static_cast<unsigned char>(i * 31 + j);
+            CPPUNIT_ASSERT(creator.send(out.data(), out.size()));
+            CPPUNIT_ASSERT(attacher.receive_all(in.data(), in.size()));
+            CPPUNIT_ASSERT(in == out);
+        }
+
+        // four times the ring, so the sender has to wait for the
+        // receiver while wrapping
+        std::vector<unsigned char> bigOut(16384 + 123);
+        for (size_t j = 0; j < bigOut.size(); j++)
+            bigOut[j] = static_cast<unsigned char>(j * 7);
+        std::vector<unsigned char> bigIn(bigOut.size());
+        std::thread sender([&creator, &bigOut]() {
+                creator.send(bigOut.data(), bigOut.size());
+            });
+        CPPUNIT_ASSERT(attacher.receive_all(bigIn.data(), bigIn.size()));
+        sender.join();
+        CPPUNIT_ASSERT(bigIn == bigOut);
+        CPPUNIT_ASSERT(attacher.bytesRead() == 20 * 1000 + bigIn.size());
+        CPPUNIT_ASSERT(creator.bytesWritten() == 20 * 1000 + bigOut.size());
+    }
+#endif
+}
+
+void TestPeerClasses::testEventLoop()
+{
+#ifdef PLATFORM_LINUX
+    using arras4::network::EventLoop;
+    using arras4::network::NonBlockingFramingSink;
+    using arras4::network::NonBlockingFramingSource;
+    using arras4::network::BufferPool;
+
+    TRACE;
+    //
+    // send frames over a loopback connection with small socket buffers,
+    // so that both ends see partial reads and writes, and the loop has
+    // to alternate between them
+    //
+    {
+        int fds[2];
+        CPPUNIT_ASSERT(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+        int bufSize = 4096;
+        CPPUNIT_ASSERT(setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &bufSize, sizeof(bufSize)) == 0);
+        CPPUNIT_ASSERT(setsockopt(fds[1], SOL_SOCKET, SO_RCVBUF, &bufSize, sizeof(bufSize)) == 0);
+        SocketPeer sender(fds[0]);
+        SocketPeer receiver(fds[1]);
+
+        NonBlockingFramingSink sink(sender);
+        NonBlockingFramingSource source(receiver, BufferPool::create());
+
+        EventLoop loop;
+        int sendCalls = 0;
+        int receiveCalls = 0;
+        loop.addPeer(sender, EventLoop::WRITABLE, [&](unsigned events) {
+                CPPUNIT_ASSERT(events & EventLoop::WRITABLE);
+                sink.sendPending();
+                sendCalls++;
+            });
+        loop.addPeer(receiver, EventLoop::READABLE, [&](unsigned events) {
+                CPPUNIT_ASSERT(events & EventLoop::READABLE);
+                source.receiveAvailable();
+                receiveCalls++;
+            });
+        CPPUNIT_ASSERT(loop.peerCount() == 2);
+
+        const size_t sizes[] = { 1, 100, 300000, 17, 70000 };
+        const size_t frameCount = sizeof(sizes) / sizeof(sizes[0]);
+        std::vector<std::vector<unsigned char>> frames;
+        for (size_t i = 0; i < frameCount; i++) {
+            std::vector<unsigned char> frame(sizes[i]);
+            for (size_t j = 0; j < frame.size(); j++)
+                frame[j] = static_cast<unsigned char>(i * 13 + j);
+            CPPUNIT_ASSERT(sink.openFrame(frame.size()));
+            CPPUNIT_ASSERT(sink.write(frame.data(), frame.size()) == frame.size());
+            CPPUNIT_ASSERT(sink.closeFrame());
+            frames.push_back(frame);
+        }
+        // the socket can't take it all at once
+        CPPUNIT_ASSERT(sink.pendingBytes() > 0);
+
+        TestTimer timer;
+        timer.start();
+        while (source.framesReady() < frameCount || sink.pendingBytes() > 0) {
+            loop.runOnce(100);
+            timer.stop();
+            CPPUNIT_ASSERT(timer.timeElapsed() < 10.0);
+        }
+        CPPUNIT_ASSERT(sendCalls > 0);
+        CPPUNIT_ASSERT(receiveCalls > 1);
+
+        for (size_t i = 0; i < frameCount; i++) {
+            CPPUNIT_ASSERT(source.nextFrame() == frames[i].size());
+            std::vector<unsigned char> frame(frames[i].size());
+            CPPUNIT_ASSERT(source.read(frame.data(), frame.size()) == frame.size());
+            CPPUNIT_ASSERT(frame == frames[i]);
+            source.endFrame();
+        }
+        CPPUNIT_ASSERT(source.nextFrame() == 0);
+
+        // removed peers get no more callbacks
+        loop.removePeer(receiver);
+        loop.removePeer(sender);
+        CPPUNIT_ASSERT(loop.peerCount() == 0);
+        int before = receiveCalls;
+        CPPUNIT_ASSERT(sink.openFrame(16));
+        sink.write(reinterpret_cast<const unsigned char*>(STANDARD_STRING16), 16);
+        CPPUNIT_ASSERT(sink.closeFrame());
+        loop.runOnce(50);
+        CPPUNIT_ASSERT(receiveCalls == before);
+    }
+
+    TRACE;
+    //
+    // closing the other end is reported as a hangup
+    //
+    {
+        int fds[2];
+        CPPUNIT_ASSERT(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+        SocketPeer* other = new SocketPeer(fds[0]);
+        SocketPeer receiver(fds[1]);
+        NonBlockingFramingSource source(receiver);
+
+        EventLoop loop;
+        bool hangup = false;
+        bool disconnected = false;
+        loop.addPeer(receiver, EventLoop::READABLE, [&](unsigned events) {
+                if (events & EventLoop::HANGUP)
+                    hangup = true;
+                try {
+                    source.receiveAvailable();
+                } catch (arras4::network::PeerDisconnectException&) {
+                    disconnected = true;
+                }
+            });
+        delete other;
+        CPPUNIT_ASSERT(loop.runOnce(1000) == 1);
+        CPPUNIT_ASSERT(hangup);
+        CPPUNIT_ASSERT(disconnected);
+    }
+
+    TRACE;
+    //
+    // removePeer on another thread waits for a callback that is
+    // already running, so the peer can be destroyed when it returns
+    //
+    {
+        int fds[2];
+        CPPUNIT_ASSERT(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+        SocketPeer other(fds[0]);
+        SocketPeer* receiver = new SocketPeer(fds[1]);
+
+        EventLoop loop;
+        std::atomic<bool> inCallback(false);
+        std::atomic<bool> callbackDone(false);
+        loop.addPeer(*receiver, EventLoop::READABLE, [&](unsigned) {
+                inCallback = true;
+                std::this_thread::sleep_for(std::chrono::milliseconds(200));
+                char buffer[16];
+                while (receiver->receive_nonblocking(buffer, sizeof(buffer)) > 0) {}
+                callbackDone = true;
+            });
+        std::thread loopThread([&loop]() { loop.run(); });
+
+        CPPUNIT_ASSERT(other.send(STANDARD_STRING16, 16));
+        while (!inCallback)
+            std::this_thread::yield();
+        loop.removePeer(*receiver);
+        CPPUNIT_ASSERT(callbackDone);
+        delete receiver;
+
+        loop.stop();
+        loopThread.join();
+        CPPUNIT_ASSERT(loop.peerCount() == 0);
+    }
+
+    TRACE;
+    //
+    // a callback can remove its own peer
+    //
+    {
+        int fds[2];
+        CPPUNIT_ASSERT(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+        SocketPeer other(fds[0]);
+        SocketPeer receiver(fds[1]);
+
+        EventLoop loop;
+        int calls = 0;
+        loop.addPeer(receiver, EventLoop::READABLE, [&](unsigned) {
+                calls++;
+                loop.removePeer(receiver);
+            });
+        CPPUNIT_ASSERT(other.send(STANDARD_STRING16, 16));
+        CPPUNIT_ASSERT(loop.runOnce(1000) == 1);
+        CPPUNIT_ASSERT(other.send(STANDARD_STRING16, 16));
+        CPPUNIT_ASSERT(loop.runOnce(50) == 0);
+        CPPUNIT_ASSERT(calls == 1);
+        CPPUNIT_ASSERT(loop.peerCount() == 0);
+    }
+#endif
+}
+
+namespace {
+
+// in-memory DataSink and DataSource, used to look at frame headers
+class MemorySink : public arras4::network::DataSink
+{
+public:
+    size_t write(const unsigned char* aBuf, size_t aLen) {
+        mData.insert(mData.end(), aBuf, aBuf + aLen);
+        return aLen;
+    }
+    void flush() {}
+    size_t bytesWritten() const { return mData.size(); }
+    std::vector<unsigned char> mData;
+};
+
+class MemorySource : public arras4::network::DataSource
+{
+public:
+    MemorySource(const std::vector<unsigned char>& aData) : mData(aData) {}
+    size_t read(unsigned char* aBuf, size_t aLen) {
+        if (mPos + aLen > mData.size())
+            return 0;
+        memcpy(aBuf, mData.data() + mPos, aLen);
+        mPos += aLen;
+        return aLen;
+    }
+    size_t skip(size_t aLen) { mPos += aLen; return aLen; }
+    size_t bytesRead() const { return mPos; }
+private:
+    std::vector<unsigned char> mData;
+    size_t mPos = 0;
+};
+
+}
+
+void TestPeerClasses::testLargeFrames()
+{
+    using arras4::network::Frame;
+    using arras4::network::FramingError;
+    using arras4::network::BasicFramingSink;
+    using arras4::network::BasicFramingSource;
+
+    const uint64_t LARGE = 5ull * 1024 * 1024 * 1024 + 17;
+
+    TRACE;
+    //
+    // lengths are split across the header fields, and the oldest
+    // version that can hold the length is used
+    //
+    {
+        Frame frame;
+        frame.setLength(LARGE);
+        CPPUNIT_ASSERT(frame.mVersion == Frame::VERSION_LARGE);
+        CPPUNIT_ASSERT(frame.mLength == static_cast<unsigned int>(LARGE));
+        CPPUNIT_ASSERT(frame.mLengthHigh == static_cast<unsigned int>(LARGE >> 32));
+        CPPUNIT_ASSERT(frame.length() == LARGE);
+
+        frame.setLength(std::numeric_limits<unsigned int>::max());
+        CPPUNIT_ASSERT(frame.mVersion == Frame::VERSION_BASIC);
+        CPPUNIT_ASSERT(frame.mLengthHigh == 0);
+        CPPUNIT_ASSERT(frame.length() == std::numeric_limits<unsigned int>::max());
+
+        // a basic header ignores the reserved field
+        frame.mLengthHigh = 1;
+        CPPUNIT_ASSERT(frame.length() == std::numeric_limits<unsigned int>::max());
+
+        CPPUNIT_ASSERT(Frame::maxLength(Frame::VERSION_BASIC) == std::numeric_limits<unsigned int>::max());
+        CPPUNIT_ASSERT(Frame::maxLength(Frame::VERSION_LARGE) > LARGE);
+    }
+
+    TRACE;
+    //
+    // a header for a frame over 4Gb is written by a sink that allows
+    // large frames, and read back by a source
+    //
+    {
+        MemorySink out;
+        BasicFramingSink sink(out);
+        sink.setFrameVersion(Frame::VERSION_CURRENT);
+        CPPUNIT_ASSERT(sink.openFrame(LARGE));
+        CPPUNIT_ASSERT(out.mData.size() == sizeof(Frame));
+
+        MemorySource in(out.mData);
+        BasicFramingSource source(in);
+        CPPUNIT_ASSERT(source.nextFrame() == LARGE);
+
+        // small frames still use basic headers
+        MemorySink smallOut;
+        BasicFramingSink smallSink(smallOut);
+        smallSink.setFrameVersion(Frame::VERSION_CURRENT);
+        CPPUNIT_ASSERT(smallSink.openFrame(16));
+        Frame header;
+        memcpy(&header, smallOut.mData.data(), sizeof(header));
+        CPPUNIT_ASSERT(header.mVersion == Frame::VERSION_BASIC);
+        CPPUNIT_ASSERT(header.length() == 16);
+    }
+
+    TRACE;
+    //
+    // a sink that hasn't been told the receiver understands large
+    // frames refuses them
+    //
+    {
+        MemorySink out;
+        BasicFramingSink sink(out);
+        CPPUNIT_ASSERT_THROW(sink.openFrame(LARGE), FramingError);
+        CPPUNIT_ASSERT(out.mData.empty());
+    }
+
+    TRACE;
+    //
+    // a header with an unknown version is rejected
+    //
+    {
+        Frame frame;
+        frame.mType = Frame::FRAME_BINARY;
+        frame.setLength(16);
+        frame.mVersion = Frame::VERSION_CURRENT + 1;
+        const unsigned char* hdr = reinterpret_cast<const unsigned char*>(&frame);
+        std::vector<unsigned char> data(hdr, hdr + sizeof(frame));
+
+        MemorySource in(data);
+        BasicFramingSource source(in);
+        CPPUNIT_ASSERT_THROW(source.nextFrame(), FramingError);
+    }
+
+#ifdef PLATFORM_LINUX
+    TRACE;
+    //
+    // the same checks in the non-blocking sink and source
+    //
+    {
+        using arras4::network::NonBlockingFramingSink;
+        using arras4::network::NonBlockingFramingSource;
+
+        int fds[2];
+        CPPUNIT_ASSERT(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+        SocketPeer sender(fds[0]);
+        SocketPeer receiver(fds[1]);
+        sender.setNonBlocking(true);
+        receiver.setNonBlocking(true);
+
+        NonBlockingFramingSink sink(sender);
+        CPPUNIT_ASSERT_THROW(sink.openFrame(LARGE), FramingError);
+
+        Frame frame;
+        frame.mType = Frame::FRAME_BINARY;
+        frame.setLength(16);
+        frame.mVersion = Frame::VERSION_CURRENT + 1;
+        CPPUNIT_ASSERT(sender.send(&frame, sizeof(frame)));
+
+        NonBlockingFramingSource source(receiver);
+        CPPUNIT_ASSERT_THROW(source.receiveAvailable(), FramingError);
+    }
+#endif
+}
+
+void TestPeerClasses::testBufferPool()
+{
+    using arras4::network::BufferPool;
+    using arras4::network::BufferPtr;
+    using arras4::network::Buffer;
+
+    const size_t MIN = BufferPool::MIN_POOLED_SIZE;
+
+    TRACE;
+    //
+    // sizes are rounded up to a power of 2 size class, and a
+    // released buffer is reused for any size in the same class
+    //
+    {
+        std::shared_ptr<BufferPool> pool = BufferPool::create(16 * MIN, 64 * MIN);
+        Buffer* first = nullptr;
+        {
+            BufferPtr buffer = pool->acquire(MIN + 1);
+            CPPUNIT_ASSERT(buffer->capacity() == 2 * MIN);
+            CPPUNIT_ASSERT(buffer->remaining() == 0);
+            buffer->write(reinterpret_cast<const unsigned char*>(STANDARD_STRING16), 16);
+            first = buffer.get();
+        }
+        CPPUNIT_ASSERT(pool->stats().misses == 1);
+        CPPUNIT_ASSERT(pool->stats().pooledBytes == 2 * MIN);
+        {
+            BufferPtr buffer = pool->acquire(2 * MIN);
+            CPPUNIT_ASSERT(buffer.get() == first);
+            // released buffers come back empty
+            CPPUNIT_ASSERT(buffer->remaining() == 0);
+            CPPUNIT_ASSERT(pool->stats().hits == 1);
+            CPPUNIT_ASSERT(pool->stats().pooledBytes == 0);
+
+            // other classes don't share it
+            BufferPtr small = pool->acquire(1);
+            CPPUNIT_ASSERT(small->capacity() == MIN);
+            CPPUNIT_ASSERT(pool->stats().misses == 2);
+        }
+        CPPUNIT_ASSERT(pool->stats().pooledBytes == 3 * MIN);
+
+        // requests over the largest class aren't pooled
+        {
+            BufferPtr buffer = pool->acquire(16 * MIN + 1);
+            CPPUNIT_ASSERT(buffer->capacity() == 16 * MIN + 1);
+            CPPUNIT_ASSERT(pool->stats().unpooled == 1);
+        }
+        CPPUNIT_ASSERT(pool->stats().pooledBytes == 3 * MIN);
+
+        pool->trim();
+        CPPUNIT_ASSERT(pool->stats().pooledBytes == 0);
+    }
+
+    TRACE;
+    //
+    // free buffers beyond the memory limit are discarded
+    //
+    {
+        std::shared_ptr<BufferPool> pool = BufferPool::create(16 * MIN, 32 * MIN);
+        {
+            std::vector<BufferPtr> buffers;
+            for (int i = 0; i < 3; i++)
+                buffers.push_back(pool->acquire(16 * MIN));
+        }
+        BufferPool::Stats stats = pool->stats();
+        CPPUNIT_ASSERT(stats.pooledBytes == 32 * MIN);
+        CPPUNIT_ASSERT(stats.discarded == 1);
+
+        // buffers whose data has been taken aren't kept either
+        unsigned char* data = nullptr;
+        {
+            BufferPtr buffer = pool->acquire(MIN);
+            data = buffer->initial();
+            buffer->releaseData();
+        }
+        CPPUNIT_ASSERT(pool->stats().discarded == 2);
+        delete[] data;
+    }
+
+    TRACE;
+    //
+    // a buffer released on another thread returns to the pool,
+    // and one released after the pool has gone is just freed
+    //
+    {
+        std::shared_ptr<BufferPool> pool = BufferPool::create(16 * MIN, 64 * MIN);
+        BufferPtr buffer = pool->acquire(MIN);
+        Buffer* raw = buffer.get();
+        std::thread releaser([&buffer]() { buffer.reset(); });
+        releaser.join();
+        CPPUNIT_ASSERT(pool->stats().pooledBytes == MIN);
+        CPPUNIT_ASSERT(pool->acquire(MIN).get() == raw);
+
+        BufferPtr orphan = pool->acquire(MIN);
+        pool.reset();
+        orphan.reset();
+    }
+}
+
+void TestPeerClasses::testMultiBufferAllocator()
+{
+    using arras4::network::MultiBufferAllocator;
+    using arras4::network::BufferUniquePtr;
+    using arras4::network::Buffer;
+
+    const size_t KB = 1024;
+    const size_t MB = 1024 * KB;
+
+    TRACE;
+    //
+    // the heap allocator uses the exact size, and frees on release
+    //
+    {
+        MultiBufferAllocator& heap = MultiBufferAllocator::heap();
+        MultiBufferAllocator::Stats before = heap.stats();
+        BufferUniquePtr segment = heap.allocate(5000);
+        CPPUNIT_ASSERT(segment->capacity() == 5000);
+        CPPUNIT_ASSERT(heap.stats().inUseBytes == before.inUseBytes + 5000);
+        CPPUNIT_ASSERT(heap.stats().allocations == before.allocations + 1);
+        heap.release(std::move(segment));
+        CPPUNIT_ASSERT(heap.stats().inUseBytes == before.inUseBytes);
+        CPPUNIT_ASSERT(heap.stats().residentBytes == before.residentBytes);
+    }
+
+    // the pooled allocator is shared by the whole process, so each
+    // case runs on a new thread, to start with an empty thread cache,
+    // and checks stats relative to where it started
+    MultiBufferAllocator& pooled = MultiBufferAllocator::pooled();
+
+    TRACE;
+    //
+    // small segments are rounded up to a size class, and reused
+    // from the thread cache, but not by other threads
+    //
+    std::thread([&pooled]() {
+            MultiBufferAllocator::Stats before = pooled.stats();
+            BufferUniquePtr segment = pooled.allocate(5000);
+            CPPUNIT_ASSERT(segment->capacity() == 8 * KB);
+            Buffer* raw = segment.get();
+            segment->write(reinterpret_cast<const unsigned char*>(STANDARD_STRING16), 16);
+            pooled.release(std::move(segment));
+            CPPUNIT_ASSERT(pooled.stats().inUseBytes == before.inUseBytes);
+            CPPUNIT_ASSERT(pooled.stats().residentBytes == before.residentBytes + 8 * KB);
+
+            segment = pooled.allocate(8 * KB);
+            CPPUNIT_ASSERT(segment.get() == raw);
+            CPPUNIT_ASSERT(segment->remaining() == 0);
+            CPPUNIT_ASSERT(pooled.stats().reuses == before.reuses + 1);
+            pooled.release(std::move(segment));
+
+            std::thread([&pooled, raw]() {
+                    BufferUniquePtr other = pooled.allocate(8 * KB);
+                    CPPUNIT_ASSERT(other.get() != raw);
+                    pooled.release(std::move(other));
+                }).join();
+        }).join();
+
+    TRACE;
+    //
+    // the thread cache is limited to 4Mb, and is freed when the
+    // thread exits
+    //
+    {
+        MultiBufferAllocator::Stats before = pooled.stats();
+        std::thread([&pooled, &before]() {
+                std::vector<BufferUniquePtr> segments;
+                for (int i = 0; i < 9; i++)
+                    segments.push_back(pooled.allocate(512 * KB));
+                for (BufferUniquePtr& segment : segments)
+                    pooled.release(std::move(segment));
+                CPPUNIT_ASSERT(pooled.stats().residentBytes == before.residentBytes + 4 * MB);
+                CPPUNIT_ASSERT(pooled.stats().inUseBytes == before.inUseBytes);
+            }).join();
+        CPPUNIT_ASSERT(pooled.stats().residentBytes == before.residentBytes);
+    }
+
+    TRACE;
+    //
+    // larger segments are cached in a shared pool, so they can be
+    // reused by any thread, and sizes over 64Mb aren't cached at all
+    //
+    {
+        MultiBufferAllocator::Stats before = pooled.stats();
+        Buffer* raw = nullptr;
+        std::thread([&pooled, &raw]() {
+                BufferUniquePtr segment = pooled.allocate(MB + 1);
+                CPPUNIT_ASSERT(segment->capacity() == 2 * MB);
+                raw = segment.get();
+                pooled.release(std::move(segment));
+            }).join();
+        std::thread([&pooled, raw]() {
+                BufferUniquePtr segment = pooled.allocate(2 * MB);
+                CPPUNIT_ASSERT(segment.get() == raw);
+                pooled.release(std::move(segment));
+            }).join();
+        CPPUNIT_ASSERT(pooled.stats().reuses == before.reuses + 1);
+
+        MultiBufferAllocator::Stats beforeHuge = pooled.stats();
+        BufferUniquePtr huge = pooled.allocate(64 * MB + 1);
+        CPPUNIT_ASSERT(huge->capacity() == 64 * MB + 1);
+        pooled.release(std::move(huge));
+        CPPUNIT_ASSERT(pooled.stats().residentBytes == beforeHuge.residentBytes);
+    }
+
+    TRACE;
+    //
+    // a segment can be released on a different thread from the one
+    // that allocated it, and a detached segment is no longer counted
+    //
+    {
+        MultiBufferAllocator::Stats before = pooled.stats();
+        BufferUniquePtr segment;
+        std::thread([&pooled, &segment]() {
+                segment = pooled.allocate(64 * KB);
+            }).join();
+        std::thread([&pooled, &segment, &before]() {
+                pooled.release(std::move(segment));
+                CPPUNIT_ASSERT(pooled.stats().inUseBytes == before.inUseBytes);
+            }).join();
+        CPPUNIT_ASSERT(pooled.stats().residentBytes == before.residentBytes);
+
+        BufferUniquePtr detached = pooled.allocate(64 * KB);
+        pooled.detach(*detached);
+        CPPUNIT_ASSERT(pooled.stats().inUseBytes == before.inUseBytes);
+        detached.reset();
+    }
+}
@@ -21,9 +21,19 @@ public:
     void testIPCSocketPeer();
     void testInetSocketPeer();
     void testPeerClasses();
+    void testSharedMemoryPeer();
+    void testEventLoop();
+    void testLargeFrames();
+    void testBufferPool();
+    void testMultiBufferAllocator();
 
     CPPUNIT_TEST_SUITE(TestPeerClasses);
         CPPUNIT_TEST(testPeerClasses);
+        CPPUNIT_TEST(testSharedMemoryPeer);
+        CPPUNIT_TEST(testEventLoop);
+        CPPUNIT_TEST(testLargeFrames);
+        CPPUNIT_TEST(testBufferPool);
+        CPPUNIT_TEST(testMultiBufferAllocator);
     CPPUNIT_TEST_SUITE_END();
 
 };